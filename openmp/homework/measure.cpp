@@ -4,8 +4,50 @@
 #include <omp.h>
 #include <algorithm>
 #include <iostream>
+#include <cstdarg>
+#include <memory>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include <limits>
+#include <atomic>
+#include <tuple>
+#include <parallel/algorithm>
+#if __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<execution>)
+#include <execution>
+#endif
+#endif
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#endif
+#include "parallel_sort.h"
 #include "argh/argh.h"
 
+using parallel_sort::cpu_has_avx2;
+using parallel_sort::philox4x32;
+using parallel_sort::distribution_stream;
+using parallel_sort::philox_uniform_fill;
+using parallel_sort::index_block_size;
+using parallel_sort::compute_bucket_indices;
+using parallel_sort::sort_bucket;
+using parallel_sort::sort_buckets_tasks;
+using parallel_sort::parallel_counts_prefix_sum;
+using parallel_sort::ThreadTime;
+using parallel_sort::ThreadPhaseTimes;
+using parallel_sort::timed_phase;
+using parallel_sort::MemoryUsage;
+using parallel_sort::MemorySampler;
+using parallel_sort::Fingerprint;
+using parallel_sort::mix;
+
 // ------ Program parameters ----------
 
 int param_threads = 1,
@@ -16,11 +58,56 @@ int param_threads = 1,
 	log_format = 1;
 
 bool sample_generator_flag = false;
+bool write_combining_flag = false;
+bool simd_flag = true;
+bool pipeline_flag = false;
+bool counters_flag = false;
+bool tasks_flag = false;
+bool memory_stats_flag = false;
+
+uint64_t param_seed = 17;
+
+std::string param_distribution = "uniform";
+std::string param_verify = "fast";
+std::string param_key_type = "double";
+
+// OpenMP schedule of loops which do not depend on it, see SCHEDULE.
+std::string param_schedule = "static";
+
+// sweep mode, lists of values, an empty list stands for the single value above.
+std::string param_sweep_file;
+std::string param_sweep_sizes, param_sweep_threads, param_sweep_bucket_sizes, param_sweep_versions, param_sweep_schedules;
+std::string param_sweep_affinities;
+int param_warmup = 1;
+
+// memory placement policy, see place().
+std::string param_placement = "default";
+
+// thread pinning policy, see pin_threads().
+std::string param_affinity = "none";
+
+// what to compute, see parallel_select(); sort is the full sort.
+std::string param_mode = "sort";
+int param_k = 10;
+int param_rank = -1;
+std::string param_quantiles = "0.25,0.5,0.75";
+
+// --bucket-size=auto, see autotune_bucket_size().
+bool autotune_flag = false;
+std::string param_tuning_file = "bucket_size.cache";
+
+// number of independent arrays the input is cut into (algorithm #4), 0 sorts it as a whole.
+int param_batch = 0;
+
+// out-of-core mode
+std::string param_input_file, param_output_file, param_generate_file;
+int param_memory_mb = 1024;
 
 // ------ Logging utilities --------------------
 
+// Loops whose result does not depend on the schedule take it at runtime (--schedule, --sweep-schedules).
 #ifndef SCHEDULE
-#define SCHEDULE schedule(static)
+#define SCHEDULE schedule(runtime)
 #endif
 
 #ifndef INFO
@@ -80,6 +167,25 @@ struct Measurement {
   double sort_buckets_time = 0.;
   double write_sorted_buckets_time = 0.;
   double sort_time = 0.;
+
+  // out-of-core mode only, MB/s, -1 when not measured.
+  double read_throughput = -1.;
+  double write_throughput = -1.;
+
+  // phase times of every thread, the fields above hold thread 0's.
+  std::vector<ThreadPhaseTimes> thread_times;
+  std::vector<ThreadTime> generate_thread_times;
+
+  // --mode other than sort, values at their ranks.
+  std::vector<int> selected_ranks;
+  std::vector<double> selected_values;
+
+  // cpu of every thread, see thread_cpus().
+  std::vector<int> thread_cpus;
+
+  // --memory-stats only, split, sort and write are in thread_times.
+  MemoryUsage generate_memory;
+  MemoryUsage verify_memory;
 };
 
 template<typename Function>
@@ -89,6 +195,299 @@ double inline timeit(Function&& timed_function) {
   return omp_get_wtime() - time_0;
 }
 
+void record_phase_times(const parallel_sort::PhaseTimes& times, Measurement& measurement) {
+  measurement.split_to_buckets_time = times.split;
+  measurement.sort_buckets_time = times.sort;
+  measurement.write_sorted_buckets_time = times.write;
+  measurement.thread_times = times.threads;
+}
+
+// Called by every thread at the end of an algorithm's parallel region,
+// measurement.thread_times is sized beforehand.
+void record_thread_times(const ThreadTime& split_to_buckets_time,
+						 const ThreadTime& sort_buckets_time,
+						 const ThreadTime& write_sorted_buckets_time,
+						 Measurement& measurement) {
+  int tid = omp_get_thread_num();
+  if (tid == 0) {
+	measurement.split_to_buckets_time = split_to_buckets_time.total();
+	measurement.sort_buckets_time = sort_buckets_time.total();
+	measurement.write_sorted_buckets_time = write_sorted_buckets_time.total();
+  }
+  measurement.thread_times[tid].split = split_to_buckets_time;
+  measurement.thread_times[tid].sort = sort_buckets_time;
+  measurement.thread_times[tid].write = write_sorted_buckets_time;
+}
+
+// ------ Hardware counters ----------
+// Per-thread cycles, instructions, LLC misses, dTLB misses and branch misses (--counters=1),
+// counted with perf_event_open for the calling thread, in user space only.
+// Every OpenMP thread opens its counters on first use, the team is reused between parallel regions.
+// When the kernel refuses (no PMU under a hypervisor, perf_event_paranoid) only timing is reported.
+
+const char* counter_names[parallel_sort::max_counters] = {
+	"cycles", "instructions", "llc_misses", "dtlb_misses", "branch_misses"
+};
+
+bool counter_available[parallel_sort::max_counters] = {};
+
+#if defined(__linux__)
+
+const uint64_t read_miss = (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+
+const perf_event_attr counter_events[parallel_sort::max_counters] = {
+	{PERF_TYPE_HARDWARE, sizeof(perf_event_attr), PERF_COUNT_HW_CPU_CYCLES},
+	{PERF_TYPE_HARDWARE, sizeof(perf_event_attr), PERF_COUNT_HW_INSTRUCTIONS},
+	{PERF_TYPE_HW_CACHE, sizeof(perf_event_attr), PERF_COUNT_HW_CACHE_LL | read_miss},
+	{PERF_TYPE_HW_CACHE, sizeof(perf_event_attr), PERF_COUNT_HW_CACHE_DTLB | read_miss},
+	{PERF_TYPE_HARDWARE, sizeof(perf_event_attr), PERF_COUNT_HW_BRANCH_MISSES},
+};
+
+int open_counter(int counter) {
+  perf_event_attr attributes = counter_events[counter];
+  attributes.exclude_kernel = 1;
+  attributes.exclude_hv = 1;
+  attributes.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0);
+}
+
+// counters of the calling thread, -1 when unavailable.
+struct ThreadCounters {
+  int fds[parallel_sort::max_counters];
+
+  ThreadCounters() {
+	for (int counter = 0; counter < parallel_sort::max_counters; counter++) {
+	  fds[counter] = counter_available[counter] ? open_counter(counter) : -1;
+	}
+  }
+
+  ~ThreadCounters() {
+	for (int fd : fds) {
+	  if (fd >= 0) {
+		close(fd);
+	  }
+	}
+  }
+};
+
+// Counts are scaled up when the kernel multiplexes more events than there are hardware counters.
+void read_hardware_counters(uint64_t* values) {
+  static thread_local ThreadCounters counters;
+  for (int counter = 0; counter < parallel_sort::max_counters; counter++) {
+	uint64_t data[3];  // value, time enabled, time running
+	values[counter] = 0;
+	if (counters.fds[counter] >= 0 && read(counters.fds[counter], data, sizeof(data)) == sizeof(data) && data[2] > 0) {
+	  values[counter] = data[1] == data[2] ? data[0] : (uint64_t)((double)data[0] * data[1] / data[2]);
+	}
+  }
+}
+
+// Probes every event once and installs the reader, false when there is nothing to count.
+bool setup_hardware_counters() {
+  bool any_available = false;
+  for (int counter = 0; counter < parallel_sort::max_counters; counter++) {
+	int fd = open_counter(counter);
+	counter_available[counter] = fd >= 0;
+	any_available |= fd >= 0;
+	if (fd >= 0) {
+	  close(fd);
+	}
+  }
+  if (any_available) {
+	parallel_sort::counter_reader() = read_hardware_counters;
+  }
+  return any_available;
+}
+
+#else
+
+bool setup_hardware_counters() {
+  return false;
+}
+
+#endif
+
+// Counters of a phase summed over threads, -1 when unavailable.
+void counter_sums(const std::vector<ThreadTime>& thread_times, long long* sums) {
+  for (int counter = 0; counter < parallel_sort::max_counters; counter++) {
+	sums[counter] = counter_available[counter] ? 0 : -1;
+	for (auto& time : thread_times) {
+	  if (counter_available[counter]) {
+		sums[counter] += time.counters[counter];
+	  }
+	}
+  }
+}
+
+// ------ Memory statistics ----------
+// Allocations and peak resident set size per phase (--memory-stats=1).
+// The global operator new counts allocations and their bytes once enabled, arrays and containers included,
+// memory mapped directly (place(), out-of-core files) only shows in the resident set size.
+// The peak is VmHWM from /proc/self/status, reset at the start of every phase through /proc/self/clear_refs;
+// where the reset is not permitted it is the peak since the start of the process.
+
+std::atomic<uint64_t> allocation_count(0);
+std::atomic<uint64_t> allocated_byte_count(0);
+bool count_allocations = false;
+
+void* operator new(std::size_t size) {
+  if (count_allocations) {
+	allocation_count.fetch_add(1, std::memory_order_relaxed);
+	allocated_byte_count.fetch_add(size, std::memory_order_relaxed);
+  }
+  void* pointer = std::malloc(size > 0 ? size : 1);
+  if (pointer == nullptr) {
+	throw std::bad_alloc();
+  }
+  return pointer;
+}
+
+// out of line, inlined into library code the pairing with free() trips -Wmismatched-new-delete.
+__attribute__((noinline)) void operator delete(void* pointer) noexcept {
+  std::free(pointer);
+}
+
+__attribute__((noinline)) void operator delete(void* pointer, std::size_t) noexcept {
+  std::free(pointer);
+}
+
+#if defined(__linux__)
+
+// bytes, 0 when unavailable.
+uint64_t read_peak_rss() {
+  std::FILE* status = std::fopen("/proc/self/status", "r");
+  if (status == nullptr) {
+	return 0;
+  }
+  char line[256];
+  unsigned long long kilobytes = 0;
+  while (std::fgets(line, sizeof(line), status) != nullptr) {
+	if (std::sscanf(line, "VmHWM: %llu kB", &kilobytes) == 1) {
+	  break;
+	}
+  }
+  std::fclose(status);
+  return kilobytes * 1024;
+}
+
+void reset_peak_rss() {
+  int fd = open("/proc/self/clear_refs", O_WRONLY);
+  if (fd >= 0) {
+	ssize_t written = write(fd, "5", 1);
+	(void)written;
+	close(fd);
+  }
+}
+
+#else
+
+uint64_t read_peak_rss() {
+  return 0;
+}
+
+void reset_peak_rss() {}
+
+#endif
+
+// see parallel_sort::MemorySampler.
+void sample_memory(MemoryUsage& usage) {
+  static uint64_t last_allocations = 0, last_allocated_bytes = 0;
+  uint64_t allocations = allocation_count.load(std::memory_order_relaxed);
+  uint64_t allocated_bytes = allocated_byte_count.load(std::memory_order_relaxed);
+  usage.allocations = allocations - last_allocations;
+  usage.allocated_bytes = allocated_bytes - last_allocated_bytes;
+  usage.peak_rss = read_peak_rss();
+  usage.sampled = true;
+  last_allocations = allocations;
+  last_allocated_bytes = allocated_bytes;
+  reset_peak_rss();
+}
+
+void setup_memory_statistics() {
+  count_allocations = true;
+  parallel_sort::memory_sampler() = sample_memory;
+}
+
+// Memory use of a step outside the timed phases (generate, verify),
+// the phases inside it are not sampled on their own.
+template<typename Function>
+MemoryUsage step_memory_usage(Function&& function) {
+  MemorySampler sampler = parallel_sort::memory_sampler();
+  if (sampler == nullptr) {
+	function();
+	return MemoryUsage();
+  }
+
+  MemoryUsage usage;
+  parallel_sort::memory_sampler() = nullptr;
+  sampler(usage);
+  function();
+  sampler(usage);
+  parallel_sort::memory_sampler() = sampler;
+  return usage;
+}
+
+// Memory use of a phase over threads, only thread 0 samples it.
+MemoryUsage phase_memory_usage(const std::vector<ThreadTime>& thread_times) {
+  MemoryUsage usage;
+  for (auto& time : thread_times) {
+	usage += time.memory;
+  }
+  return usage;
+}
+
+// with the program's threads.
+template<typename T>
+Fingerprint fingerprint(const T* values, size_t size) {
+  return parallel_sort::fingerprint(values, size, param_threads);
+}
+
+template<typename T>
+Fingerprint fingerprint(const std::vector<T>& array) {
+  return fingerprint(array.data(), array.size());
+}
+
+// --verify: none, fast (linear time) or full (against a sorted copy).
+enum class Verification { none, fast, full };
+
+Verification verification = Verification::fast;
+
+void parse_verification(const std::string& name) {
+  if (name == "none") {
+	verification = Verification::none;
+  } else if (name == "fast") {
+	verification = Verification::fast;
+  } else if (name == "full") {
+	verification = Verification::full;
+  } else {
+	log<INFO>("Unknown verification: %s\n", name.c_str());
+	exit(1);
+  }
+}
+
+// Linear-time verification (--verify=fast): sorted adjacent pairs
+// and the same multiset fingerprint as the generated input.
+template<typename T>
+void verify(const T* supposedly_sorted, size_t size, const Fingerprint& original) {
+  size_t unsorted_pairs = 0;
+#pragma omp parallel for schedule(static) reduction(+:unsorted_pairs) num_threads(param_threads)
+  for (size_t i = 1; i < size; i++) {
+	unsorted_pairs += supposedly_sorted[i - 1] > supposedly_sorted[i];
+  }
+
+  if (unsorted_pairs > 0) {
+	log<INFO>("Verification failed (%zu adjacent pairs out of order)\n", unsorted_pairs);
+  } else if (!(fingerprint(supposedly_sorted, size) == original)) {
+	log<INFO>("Verification failed (result is not a permutation of the input)\n");
+  }
+}
+
+template<typename T>
+void verify(const std::vector<T>& supposedly_sorted, const Fingerprint& original) {
+  verify(supposedly_sorted.data(), supposedly_sorted.size(), original);
+}
+
+// Full verification (--verify=full): compares against a sequentially sorted copy.
 void verify(const std::vector<double>& supposedly_sorted, const std::vector<double>& original) {
   auto original_sorted = original;
   std::sort(original_sorted.begin(), original_sorted.end());
@@ -104,236 +503,2394 @@ template<int max = 1>
 void sequential_bucket_sort(std::vector<double>& array, int no_buckets) {
   std::vector<std::vector<double>> buckets(no_buckets);
 
-  for (int i = 0; i < array.size(); i++) {
+  for (size_t i = 0; i < array.size(); i++) {
 	int bucket_index = std::min((int)(no_buckets * array[i] / max), no_buckets - 1);
 	buckets[bucket_index].push_back(array[i]);
   }
 
-  for (int i = 0; i < buckets.size(); i++) {
+  for (size_t i = 0; i < buckets.size(); i++) {
 	sort(buckets[i].begin(), buckets[i].end());
   }
 
   int array_idx = 0;
-  for (int i = 0; i < buckets.size(); i++) {
-	for (int j = 0; j < buckets[i].size(); j++) {
+  for (size_t i = 0; i < buckets.size(); i++) {
+	for (size_t j = 0; j < buckets[i].size(); j++) {
 	  array[array_idx] = buckets[i][j];
 	  array_idx++;
 	}
   }
 }
 
-// ------ Actual algorithms ----------
+// ------ Memory placement ----------
+// --placement chooses where data and bucket memory live:
+// - default:     the input is zeroed by the master thread, so on a multi-socket machine
+//                all of its pages sit on the master's node; buckets use the default allocator.
+// - first-touch: the input's pages are given back right after allocation and touched again
+//                in parallel with schedule(static), i.e. every thread places the chunk it works on;
+//                private buckets (algorithm #3, pipeline) come from per-thread arenas.
+// - thp:         first-touch with transparent huge pages (MADV_HUGEPAGE) for the input and arenas.
+// - hugetlb:     first-touch with arenas backed by reserved huge pages (MAP_HUGETLB),
+//                falling back to thp when there are none; the input uses thp.
+
+enum class Placement { standard, first_touch, transparent_huge_pages, huge_pages };
+
+Placement placement = Placement::standard;
+
+void parse_placement(const std::string& name) {
+  if (name == "default") {
+	placement = Placement::standard;
+  } else if (name == "first-touch") {
+	placement = Placement::first_touch;
+  } else if (name == "thp") {
+	placement = Placement::transparent_huge_pages;
+  } else if (name == "hugetlb") {
+	placement = Placement::huge_pages;
+  } else {
+	log<INFO>("Unknown placement: %s\n", name.c_str());
+	exit(1);
+  }
+}
 
-template<int min = 0, int max = 1>
-void uniform_fill(std::vector<double>& array) {
-#pragma omp parallel num_threads(param_threads)
-  {
-	std::uniform_real_distribution<double> distribution(min, max);
-	std::default_random_engine generator;
-	int t_thread = omp_get_thread_num();
-	generator.seed(t_thread * time(NULL) + 17);
+const size_t page_size = 4096;
+const size_t huge_page_size = 2 << 20;
 
-#pragma omp for SCHEDULE
-	for (size_t i = 0; i < array.size(); i++) {
-	  array[i] = distribution(generator);
+// Zeroes an array with the given placement. The pages of the whole-page interior are released,
+// so whoever touches them next places them; they read as zeros meanwhile.
+void place(std::vector<double>& array) {
+  if (placement == Placement::standard || array.empty()) {
+	return;
+  }
+
+  uintptr_t begin = ((uintptr_t)array.data() + page_size - 1) & ~(page_size - 1);
+  uintptr_t end = ((uintptr_t)(array.data() + array.size())) & ~(page_size - 1);
+  if (begin < end) {
+	madvise((void*)begin, end - begin, MADV_DONTNEED);
+	if (placement != Placement::first_touch) {
+	  madvise((void*)begin, end - begin, MADV_HUGEPAGE);
 	}
   }
+
+  // the same partitioning as the schedule(static) loops of the algorithms.
+#pragma omp parallel for schedule(static) num_threads(param_threads)
+  for (size_t i = 0; i < array.size(); i++) {
+	array[i] = 0.;
+  }
 }
 
+// Bump allocator for one thread's bucket storage. Memory is mapped in blocks, placed
+// by the owning thread as it writes, and reused as a whole after reset().
+// Storage left behind by growing vectors is only reclaimed by reset().
+class Arena {
+ public:
+  void* allocate(size_t bytes) {
+	bytes = (bytes + 63) & ~(size_t)63;
+	while (current < blocks.size() && blocks[current].used + bytes > blocks[current].size) {
+	  current++;
+	}
+	if (current == blocks.size()) {
+	  blocks.push_back(map_block(std::max(bytes, arena_block_size)));
+	}
+	Block& block = blocks[current];
+	void* result = block.memory + block.used;
+	block.used += bytes;
+	return result;
+  }
 
-// ------ Prefix sums ----------
+  void reset() {
+	for (auto& block : blocks) {
+	  block.used = 0;
+	}
+	current = 0;
+  }
 
-void synchronous_prefix_sum(std::vector<std::vector<double>>& buckets,
-							std::vector<int>& prefix_sum,
-							int no_buckets) {
-  for (int bucket_index = 1; bucket_index < no_buckets; bucket_index++) {
-	prefix_sum[bucket_index] =
-		buckets[bucket_index - 1].size() + prefix_sum[bucket_index - 1];
+  ~Arena() {
+	for (auto& block : blocks) {
+	  munmap(block.memory, block.size);
+	}
+  }
+
+ private:
+  static const size_t arena_block_size = 64 << 20;
+
+  struct Block {
+	char* memory;
+	size_t size;
+	size_t used;
+  };
+
+  static Block map_block(size_t bytes) {
+	bytes = (bytes + huge_page_size - 1) & ~(huge_page_size - 1);
+	void* memory = MAP_FAILED;
+#if defined(MAP_HUGETLB)
+	if (placement == Placement::huge_pages) {
+	  memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	}
+#endif
+	if (memory == MAP_FAILED) {
+	  memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	  if (memory == MAP_FAILED) {
+		log<INFO>("Cannot map %zu bytes for an arena\n", bytes);
+		exit(1);
+	  }
+	  if (placement != Placement::first_touch) {
+		madvise(memory, bytes, MADV_HUGEPAGE);
+	  }
+	}
+
+	Block block;
+	block.memory = (char*)memory;
+	block.size = bytes;
+	block.used = 0;
+	return block;
   }
+
+  std::vector<Block> blocks;
+  size_t current = 0;
+};
+
+// std::max takes it by reference.
+const size_t Arena::arena_block_size;
+
+inline Arena& thread_arena() {
+  static thread_local Arena arena;
+  return arena;
 }
 
-void parallel_prefix_sum(std::vector<std::vector<double>>& buckets,
-						 std::vector<int>& prefix_sum_z,
-						 std::vector<int>& prefix_sum,
-						 int no_buckets) {
-  int tid = omp_get_thread_num();
-  int sum = 0;
-#pragma omp for schedule(static)
-  for (int bucket_index = 1; bucket_index < no_buckets; bucket_index++) {
-	sum += buckets[bucket_index - 1].size();
-	prefix_sum[bucket_index] = sum;
+// Allocates from the calling thread's arena unless placement is default,
+// deallocation is a no-op then, the arena is reset by its thread before the next sort.
+template<typename T>
+struct ArenaAllocator {
+  typedef T value_type;
+
+  ArenaAllocator() = default;
+  template<typename U>
+  ArenaAllocator(const ArenaAllocator<U>&) {}
+
+  T* allocate(size_t n) {
+	if (placement == Placement::standard) {
+	  return static_cast<T*>(::operator new(n * sizeof(T)));
+	}
+	return static_cast<T*>(thread_arena().allocate(n * sizeof(T)));
   }
-  prefix_sum_z[tid + 1] = sum;
 
-#pragma omp barrier
-  auto offset = 0;
-  for (int i = 0; i < (tid + 1); i++) {
-	offset += prefix_sum_z[i];
+  void deallocate(T* pointer, size_t) {
+	if (placement == Placement::standard) {
+	  ::operator delete(pointer);
+	}
   }
 
-#pragma omp for schedule(static)
-  for (int bucket_index = 1; bucket_index < no_buckets; bucket_index++) {
-	prefix_sum[bucket_index] += offset;
+  bool operator==(const ArenaAllocator&) const { return true; }
+  bool operator!=(const ArenaAllocator&) const { return false; }
+};
+
+// a bucket owned by a single thread.
+typedef std::vector<double, ArenaAllocator<double>> PrivateBucket;
+
+// Called by every thread before it fills its private buckets.
+inline void reset_thread_arena() {
+  if (placement != Placement::standard) {
+	thread_arena().reset();
   }
 }
 
-// algorithm #1
-// - each thread has its own buckets
-template<int max = 1>
-void parallel_bucket_sort_1(std::vector<double>& array, Measurement& measurement) {
-  // allocate memory for buckets.
-  int no_buckets = param_size / bucket_size;
-  int buckets_per_thread = no_buckets / param_threads;
-  int estimated_bucket_size = std::max((int)array.size() / no_buckets, 1);
-  std::vector<std::vector<double>> buckets(no_buckets);
-  for (auto bucket : buckets) {
-	bucket.reserve(estimated_bucket_size);
+// ------ Topology and affinity ----------
+// --affinity pins every OpenMP thread to one logical cpu, cpus come from /sys/devices/system/cpu
+// restricted to the mask the program was started with (taskset, cgroups):
+// - none:    no pinning, the scheduler moves threads freely (default).
+// - compact: consecutive threads on consecutive physical cores of a package, packages one after
+//            another; the SMT siblings of a core are used only once every core has a thread.
+// - scatter: consecutive threads round-robin over packages, then like compact.
+// - cores:   one thread per physical core, SMT siblings stay idle; more threads than cores wrap around.
+// - smt:     consecutive threads on the SMT siblings of one core before moving to the next core.
+// The cpu every thread actually ran on is reported with the results.
+
+struct Cpu {
+  int id;
+  int package;
+  int core;
+  int sibling;  // index among the SMT siblings of its core
+  int core_rank;  // index of its core within the package
+};
+
+// "0-3,8,10-11" -> 0 1 2 3 8 10 11
+std::vector<int> parse_cpu_list(const std::string& list) {
+  std::vector<int> cpus;
+  size_t position = 0;
+  while (position < list.size()) {
+	size_t end = list.find(',', position);
+	if (end == std::string::npos) {
+	  end = list.size();
+	}
+	std::string range = list.substr(position, end - position);
+	size_t dash = range.find('-');
+	int first = std::atoi(range.c_str());
+	int last = dash == std::string::npos ? first : std::atoi(range.c_str() + dash + 1);
+	for (int cpu = first; cpu <= last; cpu++) {
+	  cpus.push_back(cpu);
+	}
+	position = end + 1;
   }
+  return cpus;
+}
 
-#pragma omp parallel shared(buckets) firstprivate(no_buckets) num_threads(param_threads)
+// first line of a sysfs file, empty when it does not exist.
+std::string read_sysfs(const std::string& path) {
+  char line[4096] = {};
+  FILE* file = std::fopen(path.c_str(), "r");
+  if (file == nullptr) {
+	return "";
+  }
+  if (std::fgets(line, sizeof(line), file) == nullptr) {
+	line[0] = 0;
+  }
+  std::fclose(file);
+  return std::string(line, std::strcspn(line, "\n"));
+}
 
-  {
-	int tid = omp_get_thread_num();
+int read_sysfs_int(const std::string& path, int fallback) {
+  std::string value = read_sysfs(path);
+  return value.empty() ? fallback : std::atoi(value.c_str());
+}
 
-	// we start by populating buckets
-	// each thread fills its own buckets.
-	double split_to_buckets_time = timeit([&] {
-	  for (size_t i = tid; i < tid + array.size(); i++) {
-		int bucket_index = std::min((int)(no_buckets * array[i % array.size()] / max), no_buckets - 1);
+#if defined(__linux__)
 
-		if (tid * buckets_per_thread <= bucket_index &&
-			(bucket_index < (tid + 1) * buckets_per_thread ||
-			tid == param_threads - 1) {
-		  buckets[bucket_index].push_back(array[i % array.size()]);
-		}
-	  }
-	});
+cpu_set_t initial_affinity;
+bool initial_affinity_read = false;
 
-	// now each thread sorts its share of buckets.
-	double sort_buckets_time = timeit([&] {
-#pragma omp for schedule(static)
-	  for (int bucket_index = 0; bucket_index < no_buckets; bucket_index++) {
-		std::sort(buckets[bucket_index].begin(), buckets[bucket_index].end());
-	  }
-	});
+std::vector<Cpu> discover_topology() {
+  const std::string root = "/sys/devices/system/cpu/";
+  std::vector<int> online = parse_cpu_list(read_sysfs(root + "online"));
+  if (online.empty()) {
+	for (int cpu = 0; cpu < sysconf(_SC_NPROCESSORS_ONLN); cpu++) {
+	  online.push_back(cpu);
+	}
+  }
 
-	// after the buckets have been sorted
-	double write_sorted_buckets_time = timeit([&] {
+  std::vector<Cpu> cpus;
+  for (int id : online) {
+	if (id >= CPU_SETSIZE || !CPU_ISSET(id, &initial_affinity)) {
+	  continue;
+	}
+	std::string topology = root + "cpu" + std::to_string(id) + "/topology/";
+	Cpu cpu;
+	cpu.id = id;
+	cpu.package = read_sysfs_int(topology + "physical_package_id", 0);
+	cpu.core = read_sysfs_int(topology + "core_id", id);
+	cpu.sibling = 0;
+	cpu.core_rank = 0;
+	cpus.push_back(cpu);
+  }
 
-	  // we compute indices where to start writing in the original array.
-	  std::vector<int> bucket_idx_to_array_idx_table(no_buckets);
-	  for (int bucket_index = 1; bucket_index < no_buckets; bucket_index++) {
-		bucket_idx_to_array_idx_table[bucket_index] =
-			buckets[bucket_index - 1].size() + bucket_idx_to_array_idx_table[bucket_index - 1];
+  // cpus are in id order, so siblings are numbered in id order as well.
+  for (size_t i = 0; i < cpus.size(); i++) {
+	std::vector<int> package_cores;
+	for (size_t j = 0; j < cpus.size(); j++) {
+	  if (cpus[j].package != cpus[i].package) {
+		continue;
 	  }
-
-	  // finally, we can write the result.
-#pragma omp for schedule(static)
-	  for (int bucket_index = 0; bucket_index < no_buckets; bucket_index++) {
-		int start_idx = bucket_idx_to_array_idx_table[bucket_index];
-		for (size_t i = 0; i < buckets[bucket_index].size(); i++) {
-		  array[start_idx + i] = buckets[bucket_index][i];
-		}
+	  if (j < i && cpus[j].core == cpus[i].core) {
+		cpus[i].sibling++;
 	  }
-	});
+	  package_cores.push_back(cpus[j].core);
+	}
+	std::sort(package_cores.begin(), package_cores.end());
+	package_cores.erase(std::unique(package_cores.begin(), package_cores.end()), package_cores.end());
+	cpus[i].core_rank = std::lower_bound(package_cores.begin(), package_cores.end(), cpus[i].core) - package_cores.begin();
+  }
+  return cpus;
+}
 
-	// update measurements at the end.
-	if (tid == 0) {
-	  measurement.split_to_buckets_time = split_to_buckets_time;
-	  measurement.sort_buckets_time = sort_buckets_time;
-	  measurement.write_sorted_buckets_time = write_sorted_buckets_time;
+// cpu ids in the order threads are placed on them.
+std::vector<int> affinity_order(const std::string& policy) {
+  std::vector<Cpu> cpus = discover_topology();
+  auto key = [&](const Cpu& cpu) -> std::tuple<int, int, int> {
+	if (policy == "compact" || policy == "cores") {
+	  return std::make_tuple(cpu.sibling, cpu.package, cpu.core_rank);
+	} else if (policy == "scatter") {
+	  return std::make_tuple(cpu.sibling, cpu.core_rank, cpu.package);
+	}
+	return std::make_tuple(cpu.package, cpu.core_rank, cpu.sibling);
+  };
+  std::stable_sort(cpus.begin(), cpus.end(), [&](const Cpu& a, const Cpu& b) { return key(a) < key(b); });
+
+  std::vector<int> order;
+  for (const Cpu& cpu : cpus) {
+	if (policy != "cores" || cpu.sibling == 0) {
+	  order.push_back(cpu.id);
 	}
   }
+  return order;
 }
 
-// algorithm #3
-// Each thread has its own private buckets
-// where it accumulates values from the array.
-template<int max = 1>
-void parallel_bucket_sort_3(std::vector<double>& array, Measurement& measurement) {
+std::vector<int> cpu_order;
+bool threads_pinned = false;
 
-  // allocate memory for shared_buckets.
-  int no_buckets = param_size / bucket_size;
-  int estimated_bucket_size = std::max((int)array.size() / no_buckets, 1);
-  std::vector<std::vector<double>> shared_buckets(no_buckets);
-  for (auto bucket : shared_buckets) {
-	bucket.reserve(estimated_bucket_size);
+void parse_affinity(const std::string& policy) {
+  if (policy != "none" && policy != "compact" && policy != "scatter" && policy != "cores" && policy != "smt") {
+	log<INFO>("Unknown affinity: %s\n", policy.c_str());
+	exit(1);
+  }
+  // once, before any thread is pinned.
+  if (!initial_affinity_read) {
+	sched_getaffinity(0, sizeof(initial_affinity), &initial_affinity);
+	initial_affinity_read = true;
   }
+  cpu_order = policy == "none" ? std::vector<int>() : affinity_order(policy);
+}
 
-  // each thread has its own private buckets.
-  std::vector<std::vector<std::vector<double>>> private_buckets(param_threads);
+// Pins the threads of the next parallel regions with param_threads threads. Called before
+// every measurement: a larger team creates new threads, a sweep may change the policy.
+// Going back to none gives the threads the initial mask again.
+void pin_threads() {
+  if (cpu_order.empty() && !threads_pinned) {
+	return;
+  }
+  threads_pinned = !cpu_order.empty();
+
+#pragma omp parallel num_threads(param_threads)
+  {
+	cpu_set_t set = initial_affinity;
+	if (threads_pinned) {
+	  CPU_ZERO(&set);
+	  CPU_SET(cpu_order[omp_get_thread_num() % cpu_order.size()], &set);
+	}
+	sched_setaffinity(0, sizeof(set), &set);
+  }
+}
+
+// cpu of every thread of a param_threads team, sampled right before the measurement.
+std::vector<int> thread_cpus() {
+  std::vector<int> cpus(param_threads, -1);
+#pragma omp parallel num_threads(param_threads)
+  cpus[omp_get_thread_num()] = sched_getcpu();
+  return cpus;
+}
+
+#else
+
+void parse_affinity(const std::string& policy) {
+  if (policy != "none") {
+	log<INFO>("Thread affinity is available on Linux only\n");
+	exit(1);
+  }
+}
+
+void pin_threads() {}
+
+std::vector<int> thread_cpus() {
+  return std::vector<int>(param_threads, -1);
+}
+
+#endif
+
+// "cpu of thread 0/cpu of thread 1/...", as reported in the results, -1 when not sampled (out-of-core).
+std::string format_thread_cpus(const std::vector<int>& cpus) {
+  if (cpus.empty()) {
+	return "-1";
+  }
+  std::string mapping;
+  for (int cpu : cpus) {
+	mapping += (mapping.empty() ? "" : "/") + std::to_string(cpu);
+  }
+  return mapping;
+}
+
+struct CacheSizes {
+  long l1d = 32 << 10;
+  long l2 = 256 << 10;
+  long l3 = 8 << 20;
+};
+
+// "48K", "2048K", "32M" -> bytes
+long parse_cache_size(const std::string& size) {
+  long bytes = std::atol(size.c_str());
+  if (size.find('K') != std::string::npos) {
+	bytes <<= 10;
+  } else if (size.find('M') != std::string::npos) {
+	bytes <<= 20;
+  }
+  return bytes;
+}
+
+// caches of cpu0, defaults are kept for levels sysfs does not describe.
+CacheSizes read_cache_sizes() {
+  CacheSizes caches;
+  for (int index = 0; index < 8; index++) {
+	std::string path = "/sys/devices/system/cpu/cpu0/cache/index" + std::to_string(index) + "/";
+	std::string level = read_sysfs(path + "level"), type = read_sysfs(path + "type");
+	long size = parse_cache_size(read_sysfs(path + "size"));
+	if (level.empty() || size <= 0) {
+	  continue;
+	}
+	if (level == "1" && type != "Instruction") {
+	  caches.l1d = size;
+	} else if (level == "2") {
+	  caches.l2 = size;
+	} else if (level == "3") {
+	  caches.l3 = size;
+	}
+  }
+  return caches;
+}
+
+// ------ Counter-based random numbers ----------
+// Philox4x32-10 from parallel_sort.h: element i of the generated array depends
+// only on the seed and i, not on the number of threads nor on SCHEDULE.
+
+// UniformRandomBitGenerator over its own counter, for std distributions.
+// One engine per element keeps results independent of how elements are split between threads.
+class PhiloxEngine {
+ public:
+  typedef uint32_t result_type;
+
+  PhiloxEngine(uint64_t seed, uint64_t element) : seed(seed), element(element) {}
+
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() { return 0xFFFFFFFF; }
+
+  result_type operator()() {
+	if (position == 4) {
+	  words[0] = (uint32_t)element;
+	  words[1] = (uint32_t)(element >> 32);
+	  words[2] = distribution_stream;
+	  words[3] = block++;
+	  philox4x32(words, seed);
+	  position = 0;
+	}
+	return words[position++];
+  }
+
+ private:
+  uint64_t seed, element;
+  uint32_t block = 0;
+  uint32_t words[4];
+  int position = 4;
+};
+
+// ------ Actual algorithms ----------
+
+const int fill_block_size = 1024;
+
+// Blocks of the array are bulk-filled from the counter-based generator.
+// Times (and counters) of every thread go to thread_times when given.
+template<int min = 0, int max = 1>
+void uniform_fill(std::vector<double>& array, std::vector<ThreadTime>* thread_times = nullptr) {
+  size_t no_blocks = (array.size() + fill_block_size - 1) / fill_block_size;
+#pragma omp parallel num_threads(param_threads)
+  {
+	ThreadTime fill_time = timed_phase([&] {
+#pragma omp for SCHEDULE nowait
+	  for (size_t block = 0; block < no_blocks; block++) {
+		size_t first = block * fill_block_size;
+		size_t count = std::min((size_t)fill_block_size, array.size() - first);
+		philox_uniform_fill(&array[first], first, count, param_seed, min, max);
+	  }
+	});
+
+	if (thread_times != nullptr) {
+	  (*thread_times)[omp_get_thread_num()] = fill_time;
+	}
+  }
+}
+
+
+// ------ Other input distributions ----------
+// Bucket algorithms assume keys in [min, max), so every distribution is clamped into it.
+
+template<int min = 0, int max = 1>
+inline double clamp_to_range(double value) {
+  return std::min(std::max(value, (double)min), std::nextafter((double)max, (double)min));
+}
+
+// Every element draws from its own counter-based engine,
+// distributions are constructed per element so no state carries over between elements.
+template<typename MakeValue>
+void parallel_fill(std::vector<double>& array, const MakeValue& make_value) {
+#pragma omp parallel num_threads(param_threads)
+  {
+#pragma omp for SCHEDULE
+	for (size_t i = 0; i < array.size(); i++) {
+	  PhiloxEngine engine(param_seed, i);
+	  array[i] = make_value(engine, i);
+	}
+  }
+}
+
+// zipf distributed ranks mapped onto evenly spaced values, the lowest ranks dominate.
+template<int min = 0, int max = 1>
+void zipf_fill(std::vector<double>& array, int no_ranks = 1000, double exponent = 1.2) {
+  std::vector<double> cdf(no_ranks);
+  double sum = 0.;
+  for (int rank = 0; rank < no_ranks; rank++) {
+	sum += 1. / std::pow(rank + 1, exponent);
+	cdf[rank] = sum;
+  }
+  for (auto& c : cdf) {
+	c /= sum;
+  }
+
+  parallel_fill(array, [&](PhiloxEngine& engine, size_t) {
+	double u = std::uniform_real_distribution<double>(0., 1.)(engine);
+	int rank = std::upper_bound(cdf.begin(), cdf.end() - 1, u) - cdf.begin();
+	return min + (max - min) * (double)rank / no_ranks;
+  });
+}
+
+template<int min = 0, int max = 1>
+void generate_data(std::vector<double>& array, std::vector<ThreadTime>* thread_times = nullptr) {
+  double size = array.size();
+
+  if (param_distribution == "uniform") {
+	uniform_fill<min, max>(array, thread_times);
+  } else if (param_distribution == "normal") {
+	parallel_fill(array, [=](PhiloxEngine& engine, size_t) {
+	  std::normal_distribution<double> normal((min + max) / 2., (max - min) / 10.);
+	  return clamp_to_range<min, max>(normal(engine));
+	});
+  } else if (param_distribution == "exponential") {
+	parallel_fill(array, [=](PhiloxEngine& engine, size_t) {
+	  std::exponential_distribution<double> exponential(10. / (max - min));
+	  return clamp_to_range<min, max>(min + exponential(engine));
+	});
+  } else if (param_distribution == "zipf") {
+	zipf_fill<min, max>(array);
+  } else if (param_distribution == "sorted") {
+	parallel_fill(array, [=](PhiloxEngine&, size_t i) {
+	  return min + (max - min) * (i / size);
+	});
+  } else if (param_distribution == "reverse") {
+	parallel_fill(array, [=](PhiloxEngine&, size_t i) {
+	  return min + (max - min) * ((size - 1 - i) / size);
+	});
+  } else if (param_distribution == "duplicates") {
+	parallel_fill(array, [=](PhiloxEngine& engine, size_t) {
+	  std::uniform_int_distribution<int> distinct(0, 99);
+	  return min + (max - min) * distinct(engine) / 100.;
+	});
+  } else {
+	log<INFO>("Unknown distribution: %s\n", param_distribution.c_str());
+	exit(1);
+  }
+}
+
+
+// ------ Prefix sums ----------
+
+void synchronous_prefix_sum(std::vector<std::vector<double>>& buckets,
+							std::vector<int>& prefix_sum,
+							int no_buckets) {
+  for (int bucket_index = 1; bucket_index < no_buckets; bucket_index++) {
+	prefix_sum[bucket_index] =
+		buckets[bucket_index - 1].size() + prefix_sum[bucket_index - 1];
+  }
+}
+
+void parallel_prefix_sum(std::vector<std::vector<double>>& buckets,
+						 std::vector<int>& prefix_sum_z,
+						 std::vector<int>& prefix_sum,
+						 int no_buckets) {
+  int tid = omp_get_thread_num();
+  int sum = 0;
+#pragma omp for schedule(static)
+  for (int bucket_index = 1; bucket_index < no_buckets; bucket_index++) {
+	sum += buckets[bucket_index - 1].size();
+	prefix_sum[bucket_index] = sum;
+  }
+  prefix_sum_z[tid + 1] = sum;
+
+#pragma omp barrier
+  auto offset = 0;
+  for (int i = 0; i < (tid + 1); i++) {
+	offset += prefix_sum_z[i];
+  }
+
+#pragma omp for schedule(static)
+  for (int bucket_index = 1; bucket_index < no_buckets; bucket_index++) {
+	prefix_sum[bucket_index] += offset;
+  }
+}
+
+void parallel_prefix_sum(const std::vector<int>& bucket_sizes,
+						 std::vector<int>& prefix_sum_z,
+						 std::vector<int>& prefix_sum,
+						 int no_buckets) {
+  int tid = omp_get_thread_num();
+  int sum = 0;
+#pragma omp for schedule(static)
+  for (int bucket_index = 1; bucket_index < no_buckets; bucket_index++) {
+	sum += bucket_sizes[bucket_index - 1];
+	prefix_sum[bucket_index] = sum;
+  }
+  prefix_sum_z[tid + 1] = sum;
+
+#pragma omp barrier
+  auto offset = 0;
+  for (int i = 0; i < (tid + 1); i++) {
+	offset += prefix_sum_z[i];
+  }
+
+#pragma omp for schedule(static)
+  for (int bucket_index = 1; bucket_index < no_buckets; bucket_index++) {
+	prefix_sum[bucket_index] += offset;
+  }
+}
+
+// algorithm #1
+// - each thread has its own buckets
+template<int max = 1>
+void parallel_bucket_sort_1(std::vector<double>& array, Measurement& measurement) {
+  // allocate memory for buckets.
+  int no_buckets = param_size / bucket_size;
+  int buckets_per_thread = no_buckets / param_threads;
+  int estimated_bucket_size = std::max((int)array.size() / no_buckets, 1);
+  std::vector<std::vector<double>> buckets(no_buckets);
+  for (auto bucket : buckets) {
+	bucket.reserve(estimated_bucket_size);
+  }
+
+#pragma omp parallel shared(buckets) firstprivate(no_buckets) num_threads(param_threads)
+
+  {
+	int tid = omp_get_thread_num();
+
+	// we start by populating buckets
+	// each thread fills its own buckets.
+	ThreadTime split_to_buckets_time = timed_phase([&] {
+	  for (size_t i = tid; i < tid + array.size(); i++) {
+		int bucket_index = std::min((int)(no_buckets * array[i % array.size()] / max), no_buckets - 1);
+
+		if (tid * buckets_per_thread <= bucket_index &&
+			(bucket_index < (tid + 1) * buckets_per_thread ||
+			tid == param_threads - 1)) {
+		  buckets[bucket_index].push_back(array[i % array.size()]);
+		}
+	  }
+	});
+
+	// now each thread sorts its share of buckets.
+	ThreadTime sort_buckets_time = timed_phase([&] {
+	  if (tasks_flag) {
+		sort_buckets_tasks(no_buckets, [&](int bucket_index) {
+		  return std::make_pair(buckets[bucket_index].data(), buckets[bucket_index].data() + buckets[bucket_index].size());
+		});
+	  } else {
+#pragma omp for SCHEDULE nowait
+		for (int bucket_index = 0; bucket_index < no_buckets; bucket_index++) {
+		  sort_bucket(buckets[bucket_index].data(), buckets[bucket_index].data() + buckets[bucket_index].size());
+		}
+	  }
+	});
+
+	// after the buckets have been sorted
+	ThreadTime write_sorted_buckets_time = timed_phase([&] {
+
+	  // we compute indices where to start writing in the original array.
+	  std::vector<int> bucket_idx_to_array_idx_table(no_buckets);
+	  for (int bucket_index = 1; bucket_index < no_buckets; bucket_index++) {
+		bucket_idx_to_array_idx_table[bucket_index] =
+			buckets[bucket_index - 1].size() + bucket_idx_to_array_idx_table[bucket_index - 1];
+	  }
+
+	  // finally, we can write the result.
+#pragma omp for SCHEDULE nowait
+	  for (int bucket_index = 0; bucket_index < no_buckets; bucket_index++) {
+		int start_idx = bucket_idx_to_array_idx_table[bucket_index];
+		for (size_t i = 0; i < buckets[bucket_index].size(); i++) {
+		  array[start_idx + i] = buckets[bucket_index][i];
+		}
+	  }
+	});
+
+	// update measurements at the end.
+	record_thread_times(split_to_buckets_time, sort_buckets_time, write_sorted_buckets_time, measurement);
+  }
+}
+
+// algorithm #2
+// Buckets are shared between threads and preallocated in one flat buffer.
+// Threads make a single pass over the array and reserve slots a block at a time
+// with atomic fetch-add on per-bucket cursors: a locked instruction per element would
+// wait every time for the previous element's store, which usually misses in cache.
+// Every thread keeps the next slot of its current block in each bucket (an int per bucket),
+// slots of a block left unused fall to the end of their bucket as +inf when sorting.
+// Elements which do not fit into their bucket's capacity
+// go to a per-thread overflow list and are merged in when writing.
+
+const int max_slot_block = 16;
+
+template<int max = 1>
+void parallel_bucket_sort_2(std::vector<double>& array, Measurement& measurement) {
+  int size = array.size();
+  int no_buckets = std::max(param_size / bucket_size, 1);
+  int estimated_bucket_size = std::max(size / no_buckets, 1);
+
+  // a power of two, so that a used up block is a mask away. The unused ends of the threads'
+  // blocks take up to a quarter of a bucket on average.
+  int slot_block = 1;
+  while (2 * slot_block <= max_slot_block && param_threads * (2 * slot_block - 1) <= estimated_bucket_size / 2) {
+	slot_block *= 2;
+  }
+
+  // bucket sizes are roughly poisson distributed, leave room for two standard deviations
+  // and the unused ends of blocks, the few larger buckets overflow.
+  int bucket_capacity = estimated_bucket_size + 2 * (int)std::ceil(std::sqrt(estimated_bucket_size)) +
+						param_threads * (slot_block - 1) / 2;
+  std::unique_ptr<double[]> shared_buckets(new double[(size_t)no_buckets * bucket_capacity]);
+
+  // slots reserved in blocks, the next slot of every thread's current block,
+  // and per bucket its elements in all and those stored in its slots.
+  std::vector<int> cursors(no_buckets);
+  std::vector<std::vector<int>> next_slots(param_threads);
+  std::vector<int> bucket_sizes(no_buckets);
+  std::vector<int> stored_sizes(no_buckets);
+
+  // (bucket_index, value) pairs which did not fit.
+  std::vector<std::vector<std::pair<int, double>>> private_overflow(param_threads);
+  std::vector<std::pair<int, double>> overflow;
+
+  // datastructures for computing prefix sum in parallel.
+  std::vector<int> prefix_sum_z(param_threads + 1);
+  std::vector<int> prefix_sum(no_buckets);
+
+#pragma omp parallel shared(shared_buckets, cursors, next_slots, private_overflow, overflow) num_threads(param_threads)
+  {
+	int tid = omp_get_thread_num();
+
+	ThreadTime split_to_buckets_time = timed_phase([&] {
+	  std::vector<int>& next_slot = next_slots[tid];
+	  next_slot.assign(no_buckets, 0);
+
+#pragma omp for SCHEDULE nowait
+	  for (int i = 0; i < size; i++) {
+		int bucket_index = std::min((int)(no_buckets * array[i] / max), no_buckets - 1);
+		int slot = next_slot[bucket_index];
+		if ((slot & (slot_block - 1)) == 0) {
+#pragma omp atomic capture
+		  {
+			slot = cursors[bucket_index];
+			cursors[bucket_index] += slot_block;
+		  }
+		}
+		next_slot[bucket_index] = slot + 1;
+
+		if (slot < bucket_capacity) {
+		  shared_buckets[(size_t)bucket_index * bucket_capacity + slot] = array[i];
+		} else {
+		  private_overflow[tid].emplace_back(bucket_index, array[i]);
+		}
+	  }
+
+	  // the unused end of every thread's block, +inf where it is within the bucket.
+#pragma omp barrier
+#pragma omp for schedule(static)
+	  for (int bucket_index = 0; bucket_index < no_buckets; bucket_index++) {
+		int reserved = cursors[bucket_index];
+		int stored = std::min(reserved, bucket_capacity);
+		double* bucket = &shared_buckets[(size_t)bucket_index * bucket_capacity];
+		for (auto& thread_next_slot : next_slots) {
+		  int first_unused = thread_next_slot[bucket_index];
+		  if ((first_unused & (slot_block - 1)) == 0) {
+			continue;
+		  }
+		  int block_end = (first_unused | (slot_block - 1)) + 1;
+		  reserved -= block_end - first_unused;
+		  for (int slot = first_unused; slot < std::min(block_end, bucket_capacity); slot++) {
+			bucket[slot] = HUGE_VAL;
+			stored--;
+		  }
+		}
+		bucket_sizes[bucket_index] = reserved;
+		stored_sizes[bucket_index] = stored;
+	  }
+	});
+
+	// now each thread sorts its share of buckets,
+	// overflowed elements are gathered and sorted by (bucket, value).
+	ThreadTime sort_buckets_time = timed_phase([&] {
+	  if (tasks_flag) {
+		sort_buckets_tasks(no_buckets, [&](int bucket_index) {
+		  double* bucket = &shared_buckets[(size_t)bucket_index * bucket_capacity];
+		  return std::make_pair(bucket, bucket + std::min(cursors[bucket_index], bucket_capacity));
+		});
+	  } else {
+#pragma omp for SCHEDULE nowait
+		for (int bucket_index = 0; bucket_index < no_buckets; bucket_index++) {
+		  double* bucket = &shared_buckets[(size_t)bucket_index * bucket_capacity];
+		  sort_bucket(bucket, bucket + std::min(cursors[bucket_index], bucket_capacity));
+		}
+	  }
+
+#pragma omp single nowait
+	  {
+		for (auto& thread_overflow : private_overflow) {
+		  overflow.insert(overflow.end(), thread_overflow.begin(), thread_overflow.end());
+		}
+		std::sort(overflow.begin(), overflow.end());
+	  }
+	});
+
+	// after the buckets have been sorted
+	ThreadTime write_sorted_buckets_time = timed_phase([&] {
+	  parallel_prefix_sum(bucket_sizes, prefix_sum_z, prefix_sum, no_buckets);
+
+#pragma omp for SCHEDULE nowait
+	  for (int bucket_index = 0; bucket_index < no_buckets; bucket_index++) {
+		double* bucket = &shared_buckets[(size_t)bucket_index * bucket_capacity];
+		double* bucket_end = bucket + stored_sizes[bucket_index];
+		double* destination = &array[prefix_sum[bucket_index]];
+
+		if (bucket_sizes[bucket_index] == stored_sizes[bucket_index]) {
+		  std::copy(bucket, bucket_end, destination);
+		} else {
+		  auto first = std::lower_bound(overflow.begin(), overflow.end(),
+										std::make_pair(bucket_index, -HUGE_VAL));
+		  auto last = first + (bucket_sizes[bucket_index] - stored_sizes[bucket_index]);
+		  while (bucket != bucket_end && first != last) {
+			*destination++ = (first->second < *bucket) ? (first++)->second : *bucket++;
+		  }
+		  destination = std::copy(bucket, bucket_end, destination);
+		  for (; first != last; first++) {
+			*destination++ = first->second;
+		  }
+		}
+	  }
+	});
+
+	// update measurements at the end.
+	record_thread_times(split_to_buckets_time, sort_buckets_time, write_sorted_buckets_time, measurement);
+  }
+}
+
+// algorithm #3
+// Each thread has its own private buckets
+// where it accumulates values from the array.
+template<int max = 1>
+void parallel_bucket_sort_3(std::vector<double>& array, Measurement& measurement) {
+
+  // allocate memory for shared_buckets.
+  int no_buckets = param_size / bucket_size;
+  int estimated_bucket_size = std::max((int)array.size() / no_buckets, 1);
+  std::vector<std::vector<double>> shared_buckets(no_buckets);
+  for (auto bucket : shared_buckets) {
+	bucket.reserve(estimated_bucket_size);
+  }
+
+  // each thread has its own private buckets.
+  std::vector<std::vector<PrivateBucket>> private_buckets(param_threads);
+
+  // datastructures for computing prefix sum in parallel.
+  std::vector<int> prefix_sum_z(param_threads + 1);
+  prefix_sum_z.reserve(param_threads + 1);
+  prefix_sum_z.push_back(0);
+
+  std::vector<int> prefix_sum(no_buckets);
+  prefix_sum.reserve(no_buckets);
+
+#pragma omp parallel shared(shared_buckets, private_buckets, no_buckets, estimated_bucket_size) num_threads(param_threads)
+  {
+	int tid = omp_get_thread_num();
+
+	ThreadTime split_to_buckets_time = timed_phase([&] {
+
+	  // each thread allocates its own private buckets.
+	  reset_thread_arena();
+	  private_buckets[tid].resize(no_buckets);
+
+	  // each thread updates its own private buckets,
+	  // bucket indices are computed a block at a time.
+	  int indices[index_block_size];
+	  int no_blocks = (array.size() + index_block_size - 1) / index_block_size;
+#pragma omp for schedule(static)
+	  for (int block = 0; block < no_blocks; block++) {
+		int first = block * index_block_size;
+		int count = std::min(index_block_size, (int)array.size() - first);
+		compute_bucket_indices(&array[first], count, indices, no_buckets, 0., max);
+		for (int j = 0; j < count; j++) {
+		  private_buckets[tid][indices[j]].push_back(array[first + j]);
+		}
+	  }
+
+	  // threads flush the results from private buckets to shared buckets.
+#pragma omp for SCHEDULE nowait
+	  for (int bucket_idx = 0; bucket_idx < no_buckets; bucket_idx++) {
+
+		for (int thread_id = 0; thread_id < param_threads; thread_id++) {
+		  for (auto v : private_buckets[thread_id][bucket_idx]) {
+			shared_buckets[bucket_idx].push_back(v);
+		  }
+		}
+	  }
+	});
+
+	// now each thread sorts its share of shared_buckets.
+	ThreadTime sort_buckets_time = timed_phase([&] {
+	  if (tasks_flag) {
+		sort_buckets_tasks(no_buckets, [&](int bucket_index) {
+		  return std::make_pair(shared_buckets[bucket_index].data(),
+								shared_buckets[bucket_index].data() + shared_buckets[bucket_index].size());
+		});
+	  } else {
+#pragma omp for SCHEDULE nowait
+		for (int bucket_index = 0; bucket_index < no_buckets; bucket_index++) {
+		  sort_bucket(shared_buckets[bucket_index].data(),
+					  shared_buckets[bucket_index].data() + shared_buckets[bucket_index].size());
+		}
+	  }
+	});
+
+	// after the shared_buckets have been sorted
+	ThreadTime write_sorted_buckets_time = timed_phase([&] {
+
+	  // we compute indices where to start writing in the original array.
+//	  synchronous_prefix_sum(shared_buckets, prefix_sum, no_buckets);
+	  parallel_prefix_sum(shared_buckets, prefix_sum_z, prefix_sum, no_buckets);
+
+	  // finally, we can write the result.
+#pragma omp for SCHEDULE nowait
+	  for (int bucket_index = 0; bucket_index < no_buckets; bucket_index++) {
+		int start_idx = prefix_sum[bucket_index];
+		for (size_t i = 0; i < shared_buckets[bucket_index].size(); i++) {
+		  array[start_idx + i] = shared_buckets[bucket_index][i];
+		}
+	  }
+	});
+
+	// update measurements at the end.
+	record_thread_times(split_to_buckets_time, sort_buckets_time, write_sorted_buckets_time, measurement);
+  }
+}
+
+// The sorter of algorithm #4 keeps its buffers between repetitions,
+// it is replaced only when the number of threads changes.
+parallel_sort::BucketSorter<double>& bucket_sorter() {
+  static std::unique_ptr<parallel_sort::BucketSorter<double>> sorter;
+  if (!sorter || sorter->threads() != param_threads) {
+	sorter.reset(new parallel_sort::BucketSorter<double>(param_threads));
+  }
+  return *sorter;
+}
+
+// algorithm #4
+// Count-then-scatter: no per-bucket vectors at all,
+// see parallel_sort::bucket_sort.
+template<int max = 1>
+void parallel_bucket_sort_4(std::vector<double>& array, Measurement& measurement) {
+  parallel_sort::PhaseTimes times;
+  bucket_sorter().sort(array, 0., max, param_size / bucket_size, &times);
+  record_phase_times(times, measurement);
+}
+
+// algorithm #4 on a batch (--batch=N)
+// The input is cut into N independent arrays, sorted by a single sort_batch call
+// and verified one by one. There are no separate phases.
+template<int max = 1>
+void parallel_bucket_sort_4_batch(const std::vector<double>& data, Measurement& measurement) {
+  std::vector<std::vector<double>> arrays(param_batch);
+  std::vector<Fingerprint> fingerprints(param_batch);
+  for (int i = 0; i < param_batch; i++) {
+	size_t first = data.size() * i / param_batch, last = data.size() * (i + 1) / param_batch;
+	arrays[i].assign(data.begin() + first, data.begin() + last);
+	if (verification == Verification::fast) {
+	  fingerprints[i] = fingerprint(arrays[i]);
+	}
+  }
+
+  measurement.sort_time = timeit([&] {
+	bucket_sorter().sort_batch(arrays, 0., max, bucket_size);
+  });
+
+  for (int i = 0; i < param_batch; i++) {
+	size_t first = data.size() * i / param_batch, last = data.size() * (i + 1) / param_batch;
+	if (verification == Verification::full) {
+	  verify(arrays[i], std::vector<double>(data.begin() + first, data.begin() + last));
+	} else if (verification == Verification::fast) {
+	  verify(arrays[i], fingerprints[i]);
+	}
+  }
+}
+
+// ------ Write-combining scatter ----------
+
+// Scattering straight into millions of buckets touches a random cache line (and often a TLB page)
+// for every element. Instead elements are staged in small per-thread, cache-line-sized
+// buffers, one per range of buckets, and written out a full line at a time.
+// The extra pass over the staging array pays off from about a million buckets on
+// (60M elements in buckets of 50, 15M in buckets of 5). With fewer, the buckets' lines
+// stay cached and plain #4 splits faster.
+
+const int cache_line_doubles = 64 / sizeof(double);
+
+// At most as many ranges as lines in half of the L1 data cache, so that a thread's
+// write-combining lines stay in L1 next to the input it streams through.
+inline int write_combining_ranges() {
+  static int ranges = std::max(64L, read_cache_sizes().l1d / 2 / 64);
+  return ranges;
+}
+
+// Non-temporal stores skip reading the destination lines but leave them uncached. Step 3 reads the staging
+// array back only after the whole of it has been written, so once it outgrows the L2 cache it is mostly
+// read from the shared levels anyway, and skipping the reads wins (measured with 2MB L2 and even a 300MB L3).
+inline bool stream_staging(size_t bytes) {
+  static long l2 = read_cache_sizes().l2;
+  return bytes > (size_t)l2;
+}
+
+struct FreeDeleter {
+  void operator()(void* pointer) const { std::free(pointer); }
+};
+
+// starts on a cache line, so line-aligned cursors mean whole lines.
+std::unique_ptr<double[], FreeDeleter> allocate_cache_aligned(size_t count) {
+  void* memory = nullptr;
+  if (posix_memalign(&memory, 64, std::max(count, (size_t)1) * sizeof(double)) != 0) {
+	log<INFO>("Cannot allocate %zu aligned doubles\n", count);
+	exit(1);
+  }
+  return std::unique_ptr<double[], FreeDeleter>((double*)memory);
+}
+
+// A whole, line-aligned line: with streaming a single write-combined line, without the destination being read.
+inline void flush_cache_line(double* destination, const double* line, bool streaming) {
+#if defined(__SSE2__) && defined(__x86_64__)
+  if (streaming) {
+	for (int i = 0; i < cache_line_doubles; i += 2) {
+	  _mm_stream_pd(&destination[i], _mm_load_pd(&line[i]));
+	}
+	return;
+  }
+#endif
+  std::copy(line, line + cache_line_doubles, destination);
+}
+
+inline void flush_fence() {
+#if defined(__SSE2__) && defined(__x86_64__)
+  _mm_sfence();
+#endif
+}
+
+// algorithm #4 with write-combining (--write-combining=1)
+// Two-level split: elements are first scattered by range of buckets
+// through write-combining buffers into a staging array,
+// then every range (small enough to stay in cache) is scattered
+// into its buckets back in the original array, where buckets are sorted in place.
+template<int max = 1>
+void parallel_bucket_sort_4_wc(std::vector<double>& array, Measurement& measurement) {
+  int size = array.size();
+  int no_buckets = std::max(param_size / bucket_size, 1);
+
+  // a range is 2^range_shift consecutive buckets, so the range of a bucket is a shift away.
+  int range_shift = 0;
+  while (((no_buckets - 1) >> range_shift) + 1 > write_combining_ranges()) {
+	range_shift++;
+  }
+  int no_ranges = ((no_buckets - 1) >> range_shift) + 1;
+  int buckets_per_range = 1 << range_shift;
+
+  std::unique_ptr<double[], FreeDeleter> staging = allocate_cache_aligned(size);
+  bool streaming = stream_staging((size_t)size * sizeof(double));
+  std::vector<int> counts((size_t)param_threads * no_ranges);
+  std::vector<int> range_start(no_ranges + 1);
+  std::vector<int> bucket_start(no_buckets + 1);
+  std::vector<int> prefix_sum_z(param_threads + 1);
+
+#pragma omp parallel shared(staging, counts, range_start, bucket_start, prefix_sum_z) num_threads(param_threads)
+  {
+	int tid = omp_get_thread_num();
+	int* my_counts = &counts[(size_t)tid * no_ranges];
+	int indices[index_block_size];
+
+	ThreadTime split_to_buckets_time = timed_phase([&] {
+
+	  // 1. each thread counts elements of its chunk per range, bucket indices a block at a time.
+	  int no_blocks = (size + index_block_size - 1) / index_block_size;
+#pragma omp for schedule(static)
+	  for (int block = 0; block < no_blocks; block++) {
+		int first = block * index_block_size;
+		int count = std::min(index_block_size, size - first);
+		compute_bucket_indices(&array[first], count, indices, no_buckets, 0., max);
+		for (int i = 0; i < count; i++) {
+		  my_counts[indices[i] >> range_shift]++;
+		}
+	  }
+
+	  parallel_counts_prefix_sum(counts, prefix_sum_z, range_start, no_ranges);
+
+	  // 2. scatter ranges into staging through write-combining lines, aligned and sized to stay in L1.
+	  //    The line of a range mirrors the staging line its cursor is in: an element goes to slot cursor % 8,
+	  //    and a line is flushed when the cursor crosses into the next one. Only the first line of a range
+	  //    can be partial (it starts at the range's offset), it is written with plain stores.
+	  std::unique_ptr<double[], FreeDeleter> lines = allocate_cache_aligned((size_t)no_ranges * cache_line_doubles);
+	  std::vector<int> line_start(my_counts, my_counts + no_ranges);
+
+	  // the same static schedule as the counting pass, every thread scatters the blocks it counted.
+#pragma omp for schedule(static) nowait
+	  for (int block = 0; block < no_blocks; block++) {
+		int first = block * index_block_size;
+		int count = std::min(index_block_size, size - first);
+		compute_bucket_indices(&array[first], count, indices, no_buckets, 0., max);
+		for (int i = 0; i < count; i++) {
+		  int range_index = indices[i] >> range_shift;
+		  double* line = &lines[(size_t)range_index * cache_line_doubles];
+		  int cursor = my_counts[range_index]++;
+		  line[cursor & (cache_line_doubles - 1)] = array[first + i];
+
+		  if (((cursor + 1) & (cache_line_doubles - 1)) == 0) {
+			int start = line_start[range_index];
+			if (start % cache_line_doubles == 0) {
+			  flush_cache_line(&staging[start], line, streaming);
+			} else {
+			  std::copy(line + start % cache_line_doubles, line + cache_line_doubles, &staging[start]);
+			}
+			line_start[range_index] = cursor + 1;
+		  }
+		}
+	  }
+
+	  // what is left of every line, plain stores.
+	  for (int range_index = 0; range_index < no_ranges; range_index++) {
+		double* line = &lines[(size_t)range_index * cache_line_doubles];
+		int start = line_start[range_index], end = my_counts[range_index];
+		std::copy(line + start % cache_line_doubles, line + start % cache_line_doubles + (end - start), &staging[start]);
+	  }
+	  if (streaming) {
+		flush_fence();
+	  }
+
+#pragma omp single
+	  range_start[no_ranges] = size;
+
+	  // 3. each range is split into its buckets, back into the original array.
+	  //    A range fits in cache, its bucket indices are computed once for counting and scattering.
+	  std::vector<int> local_counts(buckets_per_range);
+	  std::vector<int> range_indices;
+
+#pragma omp for schedule(dynamic, 16)
+	  for (int range_index = 0; range_index < no_ranges; range_index++) {
+		int first_bucket = range_index << range_shift;
+		int no_local_buckets = std::min(buckets_per_range, no_buckets - first_bucket);
+		int range_size = range_start[range_index + 1] - range_start[range_index];
+		const double* range = &staging[range_start[range_index]];
+		range_indices.resize(range_size);
+		std::fill(local_counts.begin(), local_counts.begin() + no_local_buckets, 0);
+
+		// the range lands in a contiguous window of the array, brought into cache ahead of the scatter.
+		for (int i = 0; i < range_size; i += cache_line_doubles) {
+		  __builtin_prefetch(&array[range_start[range_index] + i], 1);
+		}
+
+		compute_bucket_indices(range, range_size, range_indices.data(), no_buckets, 0., max);
+		for (int i = 0; i < range_size; i++) {
+		  local_counts[range_indices[i] - first_bucket]++;
+		}
+
+		int offset = range_start[range_index];
+		for (int j = 0; j < no_local_buckets; j++) {
+		  bucket_start[first_bucket + j] = offset;
+		  int cursor = offset;
+		  offset += local_counts[j];
+		  local_counts[j] = cursor;
+		}
+
+		for (int i = 0; i < range_size; i++) {
+		  array[local_counts[range_indices[i] - first_bucket]++] = range[i];
+		}
+	  }
+
+#pragma omp single nowait
+	  bucket_start[no_buckets] = size;
+	});
+
+	// now each thread sorts its share of buckets, in place.
+	ThreadTime sort_buckets_time = timed_phase([&] {
+	  if (tasks_flag) {
+		sort_buckets_tasks(no_buckets, [&](int bucket_index) {
+		  return std::make_pair(&array[bucket_start[bucket_index]], &array[bucket_start[bucket_index + 1]]);
+		});
+	  } else {
+#pragma omp for SCHEDULE nowait
+		for (int bucket_index = 0; bucket_index < no_buckets; bucket_index++) {
+		  sort_bucket(&array[bucket_start[bucket_index]], &array[bucket_start[bucket_index + 1]]);
+		}
+	  }
+	});
+
+	// buckets are already in place in the original array, there is nothing left to write.
+	ThreadTime write_sorted_buckets_time;
+
+	// update measurements at the end.
+	record_thread_times(split_to_buckets_time, sort_buckets_time, write_sorted_buckets_time, measurement);
+  }
+}
+
+// ------ Pipelined generation ----------
+
+// Generation and splitting as separate phases are two full passes over memory,
+// plus a third when the input is copied for verification.
+// With --pipeline=1 the input is produced in chunks into a small ring of cache-sized slots;
+// a chunk is bucketed (and fingerprinted) right after it is generated, while it is still in cache,
+// and the input array is never materialized. Slots are handed between threads
+// through two bounded lock-free queues: free slots and slots holding a generated chunk.
+
+const int pipeline_chunk_size = 16 * fill_block_size;
+
+// Bounded multi-producer multi-consumer queue (Vyukov), capacity is a power of two.
+// Every cell carries a sequence number telling whether it is free for the push
+// or holds a value for the pop of a given lap.
+class BoundedQueue {
+ public:
+  explicit BoundedQueue(size_t capacity) : cells(capacity), mask(capacity - 1) {
+	for (size_t i = 0; i < capacity; i++) {
+	  cells[i].sequence.store(i, std::memory_order_relaxed);
+	}
+  }
+
+  bool push(int value) {
+	size_t position = tail.load(std::memory_order_relaxed);
+	for (;;) {
+	  Cell& cell = cells[position & mask];
+	  intptr_t difference = (intptr_t)cell.sequence.load(std::memory_order_acquire) - (intptr_t)position;
+	  if (difference == 0) {
+		if (tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+		  cell.value = value;
+		  cell.sequence.store(position + 1, std::memory_order_release);
+		  return true;
+		}
+	  } else if (difference < 0) {
+		return false;
+	  } else {
+		position = tail.load(std::memory_order_relaxed);
+	  }
+	}
+  }
+
+  bool pop(int& value) {
+	size_t position = head.load(std::memory_order_relaxed);
+	for (;;) {
+	  Cell& cell = cells[position & mask];
+	  intptr_t difference = (intptr_t)cell.sequence.load(std::memory_order_acquire) - (intptr_t)(position + 1);
+	  if (difference == 0) {
+		if (head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+		  value = cell.value;
+		  cell.sequence.store(position + mask + 1, std::memory_order_release);
+		  return true;
+		}
+	  } else if (difference < 0) {
+		return false;
+	  } else {
+		position = head.load(std::memory_order_relaxed);
+	  }
+	}
+  }
+
+ private:
+  struct Cell {
+	std::atomic<size_t> sequence;
+	int value;
+  };
+
+  std::vector<Cell> cells;
+  size_t mask;
+
+  // head and tail on separate cache lines, consumers and producers do not share one.
+  alignas(64) std::atomic<size_t> head{0};
+  alignas(64) std::atomic<size_t> tail{0};
+};
+
+inline size_t next_power_of_two(size_t value) {
+  size_t result = 1;
+  while (result < value) {
+	result *= 2;
+  }
+  return result;
+}
+
+// sequential, for a single chunk inside a parallel region.
+inline void add_to_fingerprint(const double* values, size_t size, Fingerprint& result) {
+  for (size_t i = 0; i < size; i++) {
+	uint64_t bits = 0;
+	std::memcpy(&bits, &values[i], sizeof(double));
+	result.sum_1 += mix(bits);
+	result.sum_2 += mix(bits ^ 0x9E3779B97F4A7C15ull);
+  }
+}
+
+// algorithm #3 with pipelined generation (--pipeline=1)
+// Every thread buckets a generated chunk into its private buckets when one is ready
+// and generates the next chunk otherwise, so with a single thread every chunk goes
+// from the generator straight to the buckets. Then bucket sizes are summed up,
+// and every bucket is gathered from the private buckets into its place in array and sorted there.
+// Generation, splitting and the bucket offsets are timed together (split_to_buckets_time), rand_gen_time stays 0.
+// Unlike algorithm #3, sort_buckets_time includes gathering every bucket into place,
+// and write_sorted_buckets_time stays 0: the buckets are written by the gather.
+// The input for verification is collected on the way: its fingerprint, or a copy with --verify=full.
+template<int min = 0, int max = 1>
+void pipelined_bucket_sort(std::vector<double>& array,
+						   std::vector<double>& input_copy,
+						   Fingerprint& input_fingerprint,
+						   Measurement& measurement) {
+  if (param_distribution != "uniform") {
+	log<INFO>("Pipelined generation supports only the uniform distribution\n");
+	exit(1);
+  }
+
+  size_t size = array.size();
+  int no_buckets = std::max(param_size / bucket_size, 1);
+  size_t no_chunks = (size + pipeline_chunk_size - 1) / pipeline_chunk_size;
+  bool keep_copy = verification == Verification::full;
+  bool keep_fingerprint = verification == Verification::fast;
+  if (keep_copy) {
+	input_copy.resize(size);
+  }
+
+  // two slots per thread: one being generated, one waiting to be bucketed.
+  int no_slots = 2 * param_threads;
+  std::vector<double> slots((size_t)no_slots * pipeline_chunk_size);
+  std::vector<size_t> slot_chunk(no_slots);
+  BoundedQueue free_slots(next_power_of_two(no_slots)), ready_slots(next_power_of_two(no_slots));
+  for (int slot = 0; slot < no_slots; slot++) {
+	free_slots.push(slot);
+  }
+  std::atomic<size_t> next_chunk{0}, bucketed_chunks{0};
+
+  std::vector<std::vector<PrivateBucket>> private_buckets(param_threads);
+  std::vector<Fingerprint> thread_fingerprints(param_threads);
 
   // datastructures for computing prefix sum in parallel.
+  std::vector<int> bucket_sizes(no_buckets);
   std::vector<int> prefix_sum_z(param_threads + 1);
-  prefix_sum_z.reserve(param_threads + 1);
-  prefix_sum_z.push_back(0);
+  std::vector<int> prefix_sum(no_buckets);
+
+#pragma omp parallel num_threads(param_threads)
+  {
+	int tid = omp_get_thread_num();
+
+	ThreadTime split_to_buckets_time = timed_phase([&] {
+	  reset_thread_arena();
+	  private_buckets[tid].resize(no_buckets);
+
+	  int indices[index_block_size];
+	  while (bucketed_chunks.load(std::memory_order_acquire) < no_chunks) {
+		int slot;
+
+		// bucket a generated chunk,
+		if (ready_slots.pop(slot)) {
+		  double* chunk = &slots[(size_t)slot * pipeline_chunk_size];
+		  size_t first = slot_chunk[slot] * pipeline_chunk_size;
+		  int chunk_size = std::min((size_t)pipeline_chunk_size, size - first);
+		  for (int block_first = 0; block_first < chunk_size; block_first += index_block_size) {
+			int count = std::min(index_block_size, chunk_size - block_first);
+			compute_bucket_indices(&chunk[block_first], count, indices, no_buckets, 0., max);
+			for (int j = 0; j < count; j++) {
+			  private_buckets[tid][indices[j]].push_back(chunk[block_first + j]);
+			}
+		  }
+		  free_slots.push(slot);
+		  bucketed_chunks.fetch_add(1, std::memory_order_release);
+
+		// or generate the next one into a free slot.
+		} else if (next_chunk.load(std::memory_order_relaxed) < no_chunks && free_slots.pop(slot)) {
+		  size_t chunk_index = next_chunk.fetch_add(1, std::memory_order_relaxed);
+		  if (chunk_index >= no_chunks) {
+			free_slots.push(slot);
+			continue;
+		  }
+		  double* chunk = &slots[(size_t)slot * pipeline_chunk_size];
+		  size_t first = chunk_index * pipeline_chunk_size;
+		  size_t chunk_size = std::min((size_t)pipeline_chunk_size, size - first);
+		  philox_uniform_fill(chunk, first, chunk_size, param_seed, min, max);
+		  if (keep_copy) {
+			std::copy(chunk, chunk + chunk_size, &input_copy[first]);
+		  } else if (keep_fingerprint) {
+			add_to_fingerprint(chunk, chunk_size, thread_fingerprints[tid]);
+		  }
+		  slot_chunk[slot] = chunk_index;
+		  ready_slots.push(slot);
+		}
+	  }
+
+	  // sizes of buckets and where they start in array, once every thread has its private buckets.
+#pragma omp barrier
+#pragma omp for schedule(static)
+	  for (int bucket_index = 0; bucket_index < no_buckets; bucket_index++) {
+		int total_size = 0;
+		for (int thread_id = 0; thread_id < param_threads; thread_id++) {
+		  total_size += private_buckets[thread_id][bucket_index].size();
+		}
+		bucket_sizes[bucket_index] = total_size;
+	  }
+	  parallel_prefix_sum(bucket_sizes, prefix_sum_z, prefix_sum, no_buckets);
+	});
+
+	// every bucket is gathered into its place and sorted while still in cache.
+	ThreadTime sort_buckets_time = timed_phase([&] {
+#pragma omp for SCHEDULE nowait
+	  for (int bucket_index = 0; bucket_index < no_buckets; bucket_index++) {
+		double* bucket = &array[prefix_sum[bucket_index]];
+		double* bucket_end = bucket;
+		for (int thread_id = 0; thread_id < param_threads; thread_id++) {
+		  auto& private_bucket = private_buckets[thread_id][bucket_index];
+		  bucket_end = std::copy(private_bucket.begin(), private_bucket.end(), bucket_end);
+		}
+		sort_bucket(bucket, bucket_end);
+	  }
+	});
+
+	// buckets were gathered into place, there is nothing left to write.
+	ThreadTime write_sorted_buckets_time;
+
+	// update measurements at the end.
+	record_thread_times(split_to_buckets_time, sort_buckets_time, write_sorted_buckets_time, measurement);
+  }
+
+  for (auto& thread_fingerprint : thread_fingerprints) {
+	input_fingerprint.sum_1 += thread_fingerprint.sum_1;
+	input_fingerprint.sum_2 += thread_fingerprint.sum_2;
+  }
+}
+
+// algorithm #5
+// LSD radix sort on the order-preserving bit pattern of doubles,
+// see parallel_sort::radix_sort. Does not depend on max nor on the distribution of keys.
+void parallel_radix_sort(std::vector<double>& array, Measurement& measurement) {
+  parallel_sort::PhaseTimes times;
+  parallel_sort::radix_sort(array, param_threads, parallel_sort::Identity(), &times);
+  record_phase_times(times, measurement);
+}
+
+// Algorithms #4 and #5 on keys other than double (--key-type).
+// Data is scaled from [0, max) onto the range of the key type before sorting.
+template<typename Key, int max = 1>
+void sort_converted_keys(const std::vector<double>& data, Measurement& measurement) {
+  int value_bits = 8 * sizeof(Key) - (std::is_signed<Key>::value ? 2 : 1);
+  double scale = std::is_floating_point<Key>::value ? 1. : std::ldexp(1., value_bits) / max;
+
+  std::vector<Key> keys(data.size());
+#pragma omp parallel for schedule(static) num_threads(param_threads)
+  for (size_t i = 0; i < data.size(); i++) {
+	keys[i] = (Key)(data[i] * scale);
+  }
+  Fingerprint keys_fingerprint = fingerprint(keys);
+
+  parallel_sort::PhaseTimes times;
+  measurement.sort_time = timeit([&] {
+	if (param_algorithm_version == 4) {
+	  parallel_sort::bucket_sort(keys, 0., max * scale, param_size / bucket_size, param_threads,
+								 parallel_sort::Identity(), &times);
+	} else {
+	  parallel_sort::radix_sort(keys, param_threads, parallel_sort::Identity(), &times);
+	}
+  });
+  record_phase_times(times, measurement);
+
+  if (verification != Verification::none) {
+	verify(keys, keys_fingerprint);
+  }
+}
+
+// --key-type=record: (key, row id) pairs, the row a key was generated at.
+struct Record {
+  double key;
+  uint32_t row;
+};
+
+struct RecordKey {
+  double operator()(const Record& record) const { return record.key; }
+};
+
+// Bucket counts which are powers of two from 2^8 to 2^20 are fixed at compile time (NoBuckets).
+template<int NoBuckets = (1 << 8), typename T, typename KeyOf>
+void bucket_sort_fixed(std::vector<T>& array, double min, double max, int no_buckets, int threads,
+					   KeyOf key_of, parallel_sort::PhaseTimes* times) {
+  if (no_buckets == NoBuckets) {
+	parallel_sort::bucket_sort<NoBuckets>(array, min, max, no_buckets, threads, key_of, times);
+  } else if (NoBuckets < (1 << 20)) {
+	bucket_sort_fixed<(NoBuckets < (1 << 20) ? 2 * NoBuckets : NoBuckets)>(array, min, max, no_buckets, threads,
+																		   key_of, times);
+  } else {
+	parallel_sort::bucket_sort(array, min, max, no_buckets, threads, key_of, times);
+  }
+}
+
+// Keys in order, every row exactly once and with the key it was generated with.
+// The same check for --verify=fast and full.
+void verify_records(const std::vector<Record>& records, const std::vector<double>& data) {
+  size_t unsorted_pairs = 0;
+#pragma omp parallel for schedule(static) reduction(+:unsorted_pairs) num_threads(param_threads)
+  for (size_t i = 1; i < records.size(); i++) {
+	unsorted_pairs += records[i - 1].key > records[i].key;
+  }
+
+  std::vector<bool> seen(data.size());
+  size_t wrong_rows = 0;
+  for (auto& record : records) {
+	if (record.row >= data.size() || seen[record.row] || data[record.row] != record.key) {
+	  wrong_rows++;
+	} else {
+	  seen[record.row] = true;
+	}
+  }
+
+  if (unsorted_pairs > 0) {
+	log<INFO>("Verification failed (%zu adjacent pairs out of order)\n", unsorted_pairs);
+  } else if (wrong_rows > 0 || records.size() != data.size()) {
+	log<INFO>("Verification failed (%zu records do not match their rows)\n", wrong_rows);
+  }
+}
+
+// Algorithm #4 sorts records by key through the key-extraction functor,
+// #5 computes their argsort and gathers them in that order.
+template<int max = 1>
+void sort_records(const std::vector<double>& data, Measurement& measurement) {
+  std::vector<Record> records(data.size());
+#pragma omp parallel for schedule(static) num_threads(param_threads)
+  for (size_t i = 0; i < data.size(); i++) {
+	records[i].key = data[i];
+	records[i].row = i;
+  }
+
+  parallel_sort::PhaseTimes times;
+  measurement.sort_time = timeit([&] {
+	if (param_algorithm_version == 4) {
+	  bucket_sort_fixed(records, 0., max, std::max(param_size / bucket_size, 1), param_threads, RecordKey(), &times);
+	} else {
+	  std::vector<uint32_t> permutation = parallel_sort::argsort(records, param_threads, RecordKey(), &times);
+	  std::vector<Record> sorted(records.size());
+#pragma omp parallel for schedule(static) num_threads(param_threads)
+	  for (size_t i = 0; i < records.size(); i++) {
+		sorted[i] = records[permutation[i]];
+	  }
+	  records.swap(sorted);
+	}
+  });
+  record_phase_times(times, measurement);
+
+  if (verification != Verification::none) {
+	verify_records(records, data);
+  }
+}
+
+template<int max = 1>
+void sort_converted_keys(const std::vector<double>& data, Measurement& measurement) {
+  if (param_key_type == "record") {
+	sort_records<max>(data, measurement);
+  } else if (param_key_type == "float") {
+	sort_converted_keys<float, max>(data, measurement);
+  } else if (param_key_type == "int32") {
+	sort_converted_keys<int32_t, max>(data, measurement);
+  } else if (param_key_type == "int64") {
+	sort_converted_keys<int64_t, max>(data, measurement);
+  } else if (param_key_type == "uint64") {
+	sort_converted_keys<uint64_t, max>(data, measurement);
+  } else {
+	log<INFO>("Unknown key type: %s\n", param_key_type.c_str());
+	exit(1);
+  }
+}
+
+// ------ Sample sort ----------
+
+const int max_sample_sort_partitions = 4096;
+const int sample_sort_oversampling = 16;
+
+// Splitters in Eytzinger layout: tree[1] is the root, children of j are 2j and 2j + 1.
+void build_splitter_tree(const std::vector<double>& splitters, std::vector<double>& tree, int j, int& position) {
+  if (j >= (int)tree.size()) {
+	return;
+  }
+  build_splitter_tree(splitters, tree, 2 * j, position);
+  tree[j] = splitters[position++];
+  build_splitter_tree(splitters, tree, 2 * j + 1, position);
+}
+
+// algorithm #6
+// Sample sort: splitters are chosen from a sorted random sample,
+// so partitions stay balanced for any distribution of keys (and max is not used).
+// Elements are classified with a branchless descent through the splitter tree,
+// elements equal to a splitter go to their own equality bucket which needs no sorting.
+// Partitions are then built with count-then-scatter as in algorithm #4.
+void parallel_sample_sort(std::vector<double>& array, Measurement& measurement) {
+  int size = array.size();
+  int no_buckets = std::max(param_size / bucket_size, 1);
+
+  int no_partitions = 1, levels = 0;
+  while (no_partitions * 2 <= no_buckets && no_partitions < max_sample_sort_partitions) {
+	no_partitions *= 2;
+	levels++;
+  }
+  // every partition has a bucket for elements strictly below its splitter and one equal to it.
+  int no_classes = 2 * no_partitions;
+
+  std::vector<double> splitters(no_partitions);
+  std::vector<double> tree(no_partitions);
+
+  std::unique_ptr<double[]> output(new double[size]);
+  std::unique_ptr<uint16_t[]> oracle(new uint16_t[size]);
+  std::vector<int> counts((size_t)param_threads * no_classes);
+  std::vector<int> class_start(no_classes + 1);
+  std::vector<int> prefix_sum_z(param_threads + 1);
+
+#pragma omp parallel shared(splitters, tree, output, oracle, counts, class_start, prefix_sum_z) num_threads(param_threads)
+  {
+	int tid = omp_get_thread_num();
+	int* my_counts = &counts[(size_t)tid * no_classes];
+
+	ThreadTime split_to_buckets_time = timed_phase([&] {
+
+	  // 1. pick splitters from a sorted sample, duplicates are dropped
+	  //    and missing splitters are padded with +inf (empty partitions).
+#pragma omp single
+	  {
+		std::default_random_engine generator(17);
+		std::uniform_int_distribution<int> random_index(0, std::max(size - 1, 0));
+		std::vector<double> sample(size > 0 ? no_partitions * sample_sort_oversampling : 0);
+		for (auto& s : sample) {
+		  s = array[random_index(generator)];
+		}
+		std::sort(sample.begin(), sample.end());
+
+		int no_splitters = 0;
+		for (int i = 1; i < no_partitions; i++) {
+		  double splitter = sample[i * sample_sort_oversampling];
+		  if (no_splitters == 0 || splitters[no_splitters - 1] < splitter) {
+			splitters[no_splitters++] = splitter;
+		  }
+		}
+		std::fill(splitters.begin() + no_splitters, splitters.end(), HUGE_VAL);
+
+		int position = 0;
+		build_splitter_tree(splitters, tree, 1, position);
+	  }
+
+	  // 2. classify and count.
+#pragma omp for schedule(static)
+	  for (int i = 0; i < size; i++) {
+		double value = array[i];
+		int j = 1;
+		for (int level = 0; level < levels; level++) {
+		  j = 2 * j + (value > tree[j]);
+		}
+		int partition = j - no_partitions;
+		int class_index = 2 * partition + (value == splitters[partition]);
+		oracle[i] = class_index;
+		my_counts[class_index]++;
+	  }
+
+	  parallel_counts_prefix_sum(counts, prefix_sum_z, class_start, no_classes);
+
+#pragma omp single
+	  class_start[no_classes] = size;
+
+	  // 3. scatter, the static schedule repeats the chunks of the counting pass.
+#pragma omp for schedule(static) nowait
+	  for (int i = 0; i < size; i++) {
+		output[my_counts[oracle[i]]++] = array[i];
+	  }
+	});
+
+	// only partitions need sorting, equality buckets are sorted already.
+	ThreadTime sort_buckets_time = timed_phase([&] {
+#pragma omp for schedule(dynamic) nowait
+	  for (int partition = 0; partition < no_partitions; partition++) {
+		sort_bucket(&output[class_start[2 * partition]], &output[class_start[2 * partition + 1]]);
+	  }
+	});
+
+	ThreadTime write_sorted_buckets_time = timed_phase([&] {
+#pragma omp for schedule(static) nowait
+	  for (int i = 0; i < size; i++) {
+		array[i] = output[i];
+	  }
+	});
+
+	// update measurements at the end.
+	record_thread_times(split_to_buckets_time, sort_buckets_time, write_sorted_buckets_time, measurement);
+  }
+}
+
+// ------ In-place bucket sort ----------
+
+// Algorithm #3 holds the input, the private buckets and the shared buckets at the same time,
+// about 3n doubles. Here elements are permuted within the input array, block by block
+// (after IPS4o, Axtmann et al., "In-place parallel super scalar samplesort"), besides the array
+// only per-thread buffers of in_place_ranges blocks and a few per-range cursors are needed.
+
+const int in_place_ranges = 256;
+const int in_place_block_size = 256;
+
+enum BlockState : char { block_empty, block_full, block_placed };
+
+// algorithm #7
+// In-place two-level bucket sort:
+// 1. every thread classifies its stripe of the array by range of buckets into per-range buffers,
+//    a full buffer is written back to the front of the stripe as a block of a single range,
+// 2. blocks are permuted into the block-aligned area of their range: every range has a write
+//    cursor moving up and a read cursor moving down, guarded by a lock; a block which has not
+//    been moved yet is swapped out and placed next,
+// 3. what is left in the buffers and the ends of blocks reaching past their range fill the gaps,
+// 4. every range is split into its buckets by an American flag permutation (cycle leader)
+//    and the buckets are sorted in place while the range is still in cache.
+template<int max = 1>
+void parallel_bucket_sort_7(std::vector<double>& array, Measurement& measurement) {
+  const int block = in_place_block_size;
+  int size = array.size();
+  int no_buckets = std::max(param_size / bucket_size, 1);
+  int no_ranges = std::min(no_buckets, in_place_ranges);
+  // the last block is partial when block does not divide size.
+  int no_blocks = (size + block - 1) / block;
+
+  // bucket_index belongs to range bucket_index * no_ranges / no_buckets.
+  std::vector<int> range_first_bucket(no_ranges + 1);
+  for (int range_index = 0; range_index <= no_ranges; range_index++) {
+	range_first_bucket[range_index] = ((long long)range_index * no_buckets + no_ranges - 1) / no_ranges;
+  }
+  int max_buckets_per_range = (no_buckets + no_ranges - 1) / no_ranges;
+
+  std::unique_ptr<double[]> buffers(new double[(size_t)param_threads * no_ranges * block]);
+  std::vector<int> fill((size_t)param_threads * no_ranges);
+  std::vector<int> counts((size_t)param_threads * no_ranges);
+  std::vector<int> range_start(no_ranges + 1);
+  std::vector<int> prefix_sum_z(param_threads + 1);
+
+  // blocks of range r are [first_block[r], write_block[r]) once permuted.
+  std::vector<int> first_block(no_ranges), write_block(no_ranges), read_block(no_ranges);
+  std::vector<BlockState> block_state(no_blocks, block_empty);
+  std::vector<omp_lock_t> locks(no_ranges);
+  for (auto& lock : locks) {
+	omp_init_lock(&lock);
+  }
+
+  // elements of a range which do not fit into its area: the end of its last block reaching
+  // into the next range, or the whole block when it would reach past the end of the array.
+  std::unique_ptr<double[]> overflow(new double[(size_t)no_ranges * block]);
+  std::vector<int> overflow_size(no_ranges);
+
+#pragma omp parallel shared(buffers, fill, counts, range_start, prefix_sum_z, first_block, write_block, \
+	read_block, block_state, locks, overflow, overflow_size) num_threads(param_threads)
+  {
+	int tid = omp_get_thread_num();
+	double* my_buffers = &buffers[(size_t)tid * no_ranges * block];
+	int* my_fill = &fill[(size_t)tid * no_ranges];
+	int* my_counts = &counts[(size_t)tid * no_ranges];
+
+	auto bucket_of = [&](double value) {
+	  return std::min((int)(no_buckets * value / max), no_buckets - 1);
+	};
+	auto range_of = [&](double value) {
+	  return (int)((long long)bucket_of(value) * no_ranges / no_buckets);
+	};
+	auto block_data = [&](int range_index, int block_index) {
+	  return (long long)(block_index + 1) * block > size ? &overflow[(size_t)range_index * block]
+														 : &array[(size_t)block_index * block];
+	};
+
+	ThreadTime split_to_buckets_time = timed_phase([&] {
+
+	  // 1. local classification, stripes are whole blocks so written blocks are aligned.
+	  int first = (int)((long long)tid * no_blocks / param_threads) * block;
+	  int last = std::min((int)((long long)(tid + 1) * no_blocks / param_threads) * block, size);
+	  int write = first;
+	  for (int i = first; i < last; i++) {
+		int range_index = range_of(array[i]);
+		double* buffer = &my_buffers[(size_t)range_index * block];
+		buffer[my_fill[range_index]++] = array[i];
+		my_counts[range_index]++;
+
+		// everything up to i has been read already.
+		if (my_fill[range_index] == block) {
+		  std::copy(buffer, buffer + block, &array[write]);
+		  block_state[write / block] = block_full;
+		  write += block;
+		  my_fill[range_index] = 0;
+		}
+	  }
+
+#pragma omp barrier
+	  parallel_counts_prefix_sum(counts, prefix_sum_z, range_start, no_ranges);
+
+#pragma omp single
+	  {
+		range_start[no_ranges] = size;
+		for (int range_index = 0; range_index < no_ranges; range_index++) {
+		  first_block[range_index] = (range_start[range_index] + block - 1) / block;
+		  write_block[range_index] = first_block[range_index];
+		  read_block[range_index] = (range_start[range_index + 1] + block - 1) / block - 1;
+		}
+	  }
+
+	  // 2. block permutation, every thread starts reading from a different range.
+	  std::vector<double> in_flight(block), incoming(block);
+	  auto take_block = [&](int range_index) {
+		bool taken = false;
+		omp_set_lock(&locks[range_index]);
+		while (!taken && read_block[range_index] >= write_block[range_index]) {
+		  int block_index = read_block[range_index]--;
+		  if (block_state[block_index] == block_full) {
+			std::copy_n(&array[(size_t)block_index * block], block, in_flight.begin());
+			block_state[block_index] = block_empty;
+			taken = true;
+		  }
+		}
+		omp_unset_lock(&locks[range_index]);
+		return taken;
+	  };
+
+	  int first_range = (int)((long long)tid * no_ranges / param_threads);
+	  for (int k = 0; k < no_ranges; k++) {
+		int source = (first_range + k) % no_ranges;
+		while (take_block(source)) {
+		  bool swapped = true;
+		  while (swapped) {
+			int destination = range_of(in_flight[0]);
+			omp_set_lock(&locks[destination]);
+
+			// blocks which are in their range already stay where they are.
+			int target = write_block[destination]++;
+			while (target <= read_block[destination] && block_state[target] == block_full &&
+				   range_of(array[(size_t)target * block]) == destination) {
+			  block_state[target] = block_placed;
+			  target = write_block[destination]++;
+			}
+
+			double* target_data = block_data(destination, target);
+			swapped = target <= read_block[destination] && block_state[target] == block_full;
+			if (swapped) {
+			  std::copy_n(target_data, block, incoming.begin());
+			}
+			std::copy(in_flight.begin(), in_flight.end(), target_data);
+			block_state[target] = block_placed;
+			omp_unset_lock(&locks[destination]);
+
+			std::swap(in_flight, incoming);
+		  }
+		}
+	  }
+
+#pragma omp barrier
+
+	  // 3. the ends of blocks reaching past their range are set aside ...
+#pragma omp for schedule(static)
+	  for (int range_index = 0; range_index < no_ranges; range_index++) {
+		long long placed_end = (long long)write_block[range_index] * block;
+		if (write_block[range_index] == first_block[range_index]) {
+		  overflow_size[range_index] = 0;
+		} else if (placed_end > size) {
+		  overflow_size[range_index] = block;
+		} else if (placed_end > range_start[range_index + 1]) {
+		  overflow_size[range_index] = placed_end - range_start[range_index + 1];
+		  std::copy_n(&array[range_start[range_index + 1]], overflow_size[range_index],
+					  &overflow[(size_t)range_index * block]);
+		} else {
+		  overflow_size[range_index] = 0;
+		}
+	  }
+
+	  // ... and together with the buffers fill the gaps before and after the blocks of a range.
+#pragma omp for schedule(static) nowait
+	  for (int range_index = 0; range_index < no_ranges; range_index++) {
+		int range_end = range_start[range_index + 1];
+		int placed_begin = std::min(first_block[range_index] * block, range_end);
+		int placed_end = placed_begin;
+		if (write_block[range_index] > first_block[range_index]) {
+		  long long written_end = (long long)write_block[range_index] * block;
+		  placed_end = written_end > size ? (write_block[range_index] - 1) * block : std::min((int)written_end, range_end);
+		}
+
+		int position = range_start[range_index];
+		auto put = [&](const double* values, int count) {
+		  for (int i = 0; i < count; i++) {
+			if (position == placed_begin) {
+			  position = placed_end;
+			}
+			array[position++] = values[i];
+		  }
+		};
+
+		put(&overflow[(size_t)range_index * block], overflow_size[range_index]);
+		for (int thread_id = 0; thread_id < param_threads; thread_id++) {
+		  put(&buffers[((size_t)thread_id * no_ranges + range_index) * block], fill[(size_t)thread_id * no_ranges + range_index]);
+		}
+	  }
+	});
+
+	// 4. every range is split into its buckets in place, which are then sorted.
+	ThreadTime sort_buckets_time = timed_phase([&] {
+	  std::vector<int> local_start(max_buckets_per_range + 1), next(max_buckets_per_range);
+
+#pragma omp for SCHEDULE nowait
+	  for (int range_index = 0; range_index < no_ranges; range_index++) {
+		int first_bucket = range_first_bucket[range_index];
+		int no_local_buckets = range_first_bucket[range_index + 1] - first_bucket;
+		std::fill(next.begin(), next.begin() + no_local_buckets, 0);
+
+		for (int i = range_start[range_index]; i < range_start[range_index + 1]; i++) {
+		  next[bucket_of(array[i]) - first_bucket]++;
+		}
+
+		int offset = range_start[range_index];
+		for (int j = 0; j < no_local_buckets; j++) {
+		  local_start[j] = offset;
+		  offset += next[j];
+		  next[j] = local_start[j];
+		}
+		local_start[no_local_buckets] = offset;
+
+		// every element is moved straight to the next free slot of its bucket.
+		for (int j = 0; j < no_local_buckets; j++) {
+		  while (next[j] < local_start[j + 1]) {
+			double value = array[next[j]];
+			int k = bucket_of(value) - first_bucket;
+			while (k != j) {
+			  std::swap(value, array[next[k]++]);
+			  k = bucket_of(value) - first_bucket;
+			}
+			array[next[j]++] = value;
+		  }
+		}
+
+		for (int j = 0; j < no_local_buckets; j++) {
+		  sort_bucket(&array[local_start[j]], &array[local_start[j + 1]]);
+		}
+	  }
+	});
+
+	// buckets are already in place in the original array, there is nothing left to write.
+	ThreadTime write_sorted_buckets_time;
+
+	// update measurements at the end.
+	record_thread_times(split_to_buckets_time, sort_buckets_time, write_sorted_buckets_time, measurement);
+  }
+
+  for (auto& lock : locks) {
+	omp_destroy_lock(&lock);
+  }
+}
+
+// ------ Baselines ----------
+// Library sorts, run through the same measure() / log_results() pipeline and sweep:
+// - #8:  std::sort, sequential,
+// - #9:  __gnu_parallel::sort, libstdc++ parallel mode (multiway mergesort on --threads threads),
+// - #10: std::sort(std::execution::par_unseq), C++17 builds only (make STD=-std=c++17 LIBS=-ltbb),
+//        the number of threads is up to the backend,
+// - #11: sequential_bucket_sort.
+// They have no phases, only the overall time is reported.
+// speedups.py turns a sweep over versions into speedups over the best library baseline (#8-#10).
+
+void library_sort(std::vector<double>& array) {
+  std::sort(array.begin(), array.end());
+}
+
+void gnu_parallel_sort(std::vector<double>& array) {
+  __gnu_parallel::sort(array.begin(), array.end(), __gnu_parallel::multiway_mergesort_tag(param_threads));
+}
+
+bool par_unseq_available() {
+#if defined(__cpp_lib_parallel_algorithm)
+  return true;
+#else
+  return false;
+#endif
+}
+
+void par_unseq_sort(std::vector<double>& array) {
+#if defined(__cpp_lib_parallel_algorithm)
+  std::sort(std::execution::par_unseq, array.begin(), array.end());
+#else
+  log<INFO>("std::execution::par_unseq is not available in this build (see make STD=-std=c++17)\n");
+  exit(1);
+#endif
+}
+
+// ------ Selection modes ----------
+// --mode=topk|select|quantiles computes a few order statistics instead of sorting,
+// see parallel_sort::select_ranks: only buckets holding the requested ranks are ordered.
+// - topk:      the --k largest values,
+// - select:    the value at --rank (0-based, default the median),
+// - quantiles: the values at --quantiles, e.g. 0.01,0.5,0.99.
+
+std::vector<double> parse_quantiles(const std::string& list) {
+  std::vector<double> qs;
+  const char* position = list.c_str();
+  while (*position != 0) {
+	char* end;
+	qs.push_back(std::strtod(position, &end));
+	if (end == position) {
+	  log<INFO>("Invalid quantiles: %s\n", list.c_str());
+	  exit(1);
+	}
+	position = *end == ',' ? end + 1 : end;
+  }
+  return qs;
+}
+
+template<int max = 1>
+void parallel_select(std::vector<double>& array, Measurement& measurement) {
+  int no_buckets = std::max(param_size / bucket_size, 1);
+  int size = array.size();
+  parallel_sort::PhaseTimes times;
+
+  if (param_mode == "topk") {
+	measurement.selected_values = parallel_sort::top_k(array, param_k, 0., max, no_buckets, param_threads,
+													   parallel_sort::Identity(), &times);
+	for (int i = 0; i < (int)measurement.selected_values.size(); i++) {
+	  measurement.selected_ranks.push_back(size - 1 - i);
+	}
+  } else if (param_mode == "select") {
+	int rank = param_rank < 0 ? size / 2 : param_rank;
+	if (rank >= size) {
+	  log<INFO>("Rank %d out of range\n", rank);
+	  exit(1);
+	}
+	measurement.selected_ranks.push_back(rank);
+	measurement.selected_values = parallel_sort::select_ranks(array, measurement.selected_ranks, 0., max, no_buckets,
+															  param_threads, parallel_sort::Identity(), &times);
+  } else if (param_mode == "quantiles") {
+	std::vector<double> qs = parse_quantiles(param_quantiles);
+	measurement.selected_values = parallel_sort::quantiles(array, qs, 0., max, no_buckets, param_threads,
+														   parallel_sort::Identity(), &times);
+	for (double q : qs) {
+	  measurement.selected_ranks.push_back((int)(std::min(std::max(q, 0.), 1.) * (size - 1)));
+	}
+  } else {
+	log<INFO>("Unknown mode: %s\n", param_mode.c_str());
+	exit(1);
+  }
+  record_phase_times(times, measurement);
+}
+
+// full: against a sorted copy of the input,
+// fast: a value v is at rank r when at most r elements are below v and more than r are not above it,
+//       counted for all requested values in a single pass.
+void verify_selection(const std::vector<double>& original, const Measurement& measurement) {
+  const std::vector<int>& ranks = measurement.selected_ranks;
+  const std::vector<double>& values = measurement.selected_values;
+
+  std::vector<double> sorted;
+  if (verification == Verification::full) {
+	sorted = original;
+	std::sort(sorted.begin(), sorted.end());
+  }
+
+  // below[i] and not_above[i] count elements x with x < distinct[i] and x <= distinct[i];
+  // every element adds one at the first distinct value it is below (not above), prefix sums do the rest.
+  std::vector<double> distinct = values;
+  std::sort(distinct.begin(), distinct.end());
+  distinct.erase(std::unique(distinct.begin(), distinct.end()), distinct.end());
+  std::vector<long long> below(distinct.size() + 1), not_above(distinct.size() + 1);
+  if (verification == Verification::fast) {
+#pragma omp parallel num_threads(param_threads)
+	{
+	  std::vector<long long> my_below(distinct.size() + 1), my_not_above(distinct.size() + 1);
+#pragma omp for schedule(static) nowait
+	  for (size_t j = 0; j < original.size(); j++) {
+		my_below[std::upper_bound(distinct.begin(), distinct.end(), original[j]) - distinct.begin()]++;
+		my_not_above[std::lower_bound(distinct.begin(), distinct.end(), original[j]) - distinct.begin()]++;
+	  }
+#pragma omp critical
+	  for (size_t i = 0; i <= distinct.size(); i++) {
+		below[i] += my_below[i];
+		not_above[i] += my_not_above[i];
+	  }
+	}
+	for (size_t i = 1; i <= distinct.size(); i++) {
+	  below[i] += below[i - 1];
+	  not_above[i] += not_above[i - 1];
+	}
+  }
+
+  for (size_t i = 0; i < ranks.size(); i++) {
+	bool correct = true;
+	if (verification == Verification::full) {
+	  correct = sorted[ranks[i]] == values[i];
+	} else if (verification == Verification::fast) {
+	  size_t index = std::lower_bound(distinct.begin(), distinct.end(), values[i]) - distinct.begin();
+	  correct = below[index] <= ranks[i] && ranks[i] < not_above[index];
+	}
+	if (!correct) {
+	  log<INFO>("Verification failed (rank %d: %lf)\n", ranks[i], values[i]);
+	  return;
+	}
+  }
+}
+
+// ------ Out-of-core sort ----------
+// Sorts a binary file of doubles which does not have to fit in memory:
+// 1. the mmapped input is streamed in chunks and partitioned into on-disk runs
+//    with the bucket index formula (one run per range of values between its min and max),
+// 2. runs are loaded one at a time, sorted in parallel and appended to the output,
+//    runs too large for memory are partitioned again first.
+// NaN and infinite values are rejected.
+
+const size_t out_of_core_chunk_size = 1 << 22;
+const int run_buffer_size = 8192;
+
+struct MappedFile {
+  const double* values = nullptr;
+  size_t size = 0;
+  size_t bytes = 0;
+};
+
+MappedFile map_file(const std::string& path) {
+  MappedFile file;
+  int fd = open(path.c_str(), O_RDONLY);
+  struct stat file_stat;
+  if (fd < 0 || fstat(fd, &file_stat) != 0) {
+	log<INFO>("Cannot open %s\n", path.c_str());
+	exit(1);
+  }
+
+  file.bytes = file_stat.st_size;
+  file.size = file.bytes / sizeof(double);
+  if (file.bytes > 0) {
+	void* address = mmap(nullptr, file.bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (address == MAP_FAILED) {
+	  log<INFO>("Cannot mmap %s\n", path.c_str());
+	  exit(1);
+	}
+	madvise(address, file.bytes, MADV_SEQUENTIAL);
+	file.values = (const double*)address;
+  }
+  close(fd);
+  return file;
+}
+
+void unmap_file(MappedFile& file) {
+  if (file.values != nullptr) {
+	munmap((void*)file.values, file.bytes);
+  }
+}
 
-  std::vector<int> prefix_sum(no_buckets);
-  prefix_sum.reserve(no_buckets);
+void write_fully(int fd, const double* values, size_t count, off_t offset) {
+  const char* bytes = (const char*)values;
+  size_t remaining = count * sizeof(double);
+  while (remaining > 0) {
+	ssize_t written = pwrite(fd, bytes, remaining, offset);
+	if (written <= 0) {
+	  log<INFO>("Write failed\n");
+	  exit(1);
+	}
+	bytes += written;
+	remaining -= written;
+	offset += written;
+  }
+}
 
-#pragma omp parallel shared(shared_buckets, private_buckets, no_buckets, estimated_bucket_size) num_threads(param_threads)
-  {
-	int tid = omp_get_thread_num();
+void read_fully(int fd, double* values, size_t count, off_t offset) {
+  char* bytes = (char*)values;
+  size_t remaining = count * sizeof(double);
+  while (remaining > 0) {
+	ssize_t read_bytes = pread(fd, bytes, remaining, offset);
+	if (read_bytes <= 0) {
+	  log<INFO>("Read failed\n");
+	  exit(1);
+	}
+	bytes += read_bytes;
+	remaining -= read_bytes;
+	offset += read_bytes;
+  }
+}
 
-	double split_to_buckets_time = timeit([&] {
+// A run on disk, min and max bound its values.
+struct Run {
+  std::string path;
+  int fd = -1;
+  off_t size = 0;
+  double min = HUGE_VAL;
+  double max = -HUGE_VAL;
+};
 
-	  // each thread allocates its own private buckets.
-	  private_buckets[tid].resize(no_buckets);
-	  for (auto bucket : private_buckets[tid]) {
-		bucket.reserve(estimated_bucket_size);
-	  }
+// Writes param_size uniform doubles of the --seed sequence, a chunk at a time.
+void generate_file(const std::string& path) {
+  int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+	log<INFO>("Cannot create %s\n", path.c_str());
+	exit(1);
+  }
 
-	  // each thread updates its own private buckets.
-#pragma omp for schedule(static)
-	  for (size_t i = 0; i < array.size(); i++) {
-		int bucket_index = std::min((int)(no_buckets * array[i] / max), no_buckets - 1);
-		private_buckets[tid][bucket_index].push_back(array[i]);
-	  }
+  std::vector<double> chunk(std::min((size_t)param_size, out_of_core_chunk_size));
+  for (size_t first = 0; first < (size_t)param_size; first += chunk.size()) {
+	size_t count = std::min(chunk.size(), param_size - first);
+#pragma omp parallel for schedule(static) num_threads(param_threads)
+	for (size_t block = 0; block < count; block += fill_block_size) {
+	  size_t block_count = std::min((size_t)fill_block_size, count - block);
+	  philox_uniform_fill(&chunk[block], first + block, block_count, param_seed, 0., 1.);
+	}
+	write_fully(fd, chunk.data(), count, first * sizeof(double));
+  }
+  close(fd);
+}
 
-	  // threads flush the results from private buckets to shared buckets.
-#pragma omp for schedule(static)
-	  for (int bucket_idx = 0; bucket_idx < no_buckets; bucket_idx++) {
+// Partitions values in [min, max] into no_runs run files named prefix.run.<index>
+// with the bucket index formula, every thread stages elements in its own buffer per run
+// and appends full buffers at offsets reserved with an atomic capture.
+std::vector<Run> partition_into_runs(const double* values, size_t size, double min, double max, int no_runs,
+									 const std::string& prefix) {
+  std::vector<Run> runs(no_runs);
+  for (int run_index = 0; run_index < no_runs; run_index++) {
+	Run& run = runs[run_index];
+	run.path = prefix + ".run." + std::to_string(run_index);
+	run.fd = open(run.path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (run.fd < 0) {
+	  log<INFO>("Cannot create %s\n", run.path.c_str());
+	  exit(1);
+	}
+  }
 
-		for (int thread_id = 0; thread_id < param_threads; thread_id++) {
-		  for (auto v : private_buckets[thread_id][bucket_idx]) {
-			shared_buckets[bucket_idx].push_back(v);
-		  }
+#pragma omp parallel shared(runs) num_threads(param_threads)
+  {
+	std::vector<double> buffers((size_t)no_runs * run_buffer_size);
+	std::vector<int> fill(no_runs);
+	std::vector<double> run_min(no_runs, HUGE_VAL), run_max(no_runs, -HUGE_VAL);
+
+	auto flush = [&](int run_index) {
+	  off_t position;
+#pragma omp atomic capture
+	  {
+		position = runs[run_index].size;
+		runs[run_index].size += fill[run_index];
+	  }
+	  write_fully(runs[run_index].fd, &buffers[(size_t)run_index * run_buffer_size],
+				  fill[run_index], position * sizeof(double));
+	  fill[run_index] = 0;
+	};
+
+	for (size_t first = 0; first < size; first += out_of_core_chunk_size) {
+	  size_t last = std::min(first + out_of_core_chunk_size, size);
+#pragma omp for schedule(static) nowait
+	  for (size_t i = first; i < last; i++) {
+		int run_index = parallel_sort::bucket_index(values[i], no_runs, min, max);
+		run_min[run_index] = std::min(run_min[run_index], values[i]);
+		run_max[run_index] = std::max(run_max[run_index], values[i]);
+		buffers[(size_t)run_index * run_buffer_size + fill[run_index]++] = values[i];
+		if (fill[run_index] == run_buffer_size) {
+		  flush(run_index);
 		}
 	  }
-	});
+	}
 
-	// now each thread sorts its share of shared_buckets.
-	double sort_buckets_time = timeit([&] {
-#pragma omp for schedule(static)
-	  for (int bucket_index = 0; bucket_index < no_buckets; bucket_index++) {
-		std::sort(shared_buckets[bucket_index].begin(), shared_buckets[bucket_index].end());
+	for (int run_index = 0; run_index < no_runs; run_index++) {
+	  if (fill[run_index] > 0) {
+		flush(run_index);
 	  }
+	}
+
+#pragma omp critical
+	for (int run_index = 0; run_index < no_runs; run_index++) {
+	  runs[run_index].min = std::min(runs[run_index].min, run_min[run_index]);
+	  runs[run_index].max = std::max(runs[run_index].max, run_max[run_index]);
+	}
+  }
+  return runs;
+}
+
+// Runs of at most about half the memory limit, radix sort needs about 3 doubles per element.
+size_t max_run_size() {
+  return std::max((size_t)param_memory_mb * 1024 * 1024 / (4 * sizeof(double)), (size_t)1);
+}
+
+int runs_for(size_t size) {
+  return std::max((int)((2 * size + max_run_size() - 1) / max_run_size()), 2);
+}
+
+void close_run(Run& run) {
+  close(run.fd);
+  unlink(run.path.c_str());
+}
+
+// Appends a run to the output, sorted. Runs over the memory limit (skewed input) are partitioned again
+// over their own range of values, runs of a single value are copied as they are, a chunk at a time.
+void sort_run(Run& run, int output, off_t& output_size, Measurement& measurement) {
+  if ((size_t)run.size > 2 * max_run_size() && run.min < run.max) {
+	MappedFile mapped = map_file(run.path);
+	std::vector<Run> runs;
+	measurement.split_to_buckets_time += timeit([&] {
+	  runs = partition_into_runs(mapped.values, mapped.size, run.min, run.max, runs_for(mapped.size), run.path);
 	});
+	unmap_file(mapped);
+	close_run(run);
+	for (auto& sub_run : runs) {
+	  sort_run(sub_run, output, output_size, measurement);
+	}
+	return;
+  }
 
-	// after the shared_buckets have been sorted
-	double write_sorted_buckets_time = timeit([&] {
+  size_t chunk_size = run.min < run.max ? (size_t)run.size : std::min((size_t)run.size, out_of_core_chunk_size);
+  std::vector<double> chunk(chunk_size);
+  for (size_t first = 0; first < (size_t)run.size; first += chunk_size) {
+	size_t count = std::min(chunk_size, run.size - first);
+	chunk.resize(count);
+	measurement.write_sorted_buckets_time += timeit([&] {
+	  read_fully(run.fd, chunk.data(), count, first * sizeof(double));
+	});
 
-	  // we compute indices where to start writing in the original array.
-//	  synchronous_prefix_sum(shared_buckets, prefix_sum, no_buckets);
-	  parallel_prefix_sum(shared_buckets, prefix_sum_z, prefix_sum, no_buckets);
+	if (run.min < run.max) {
+	  Measurement run_measurement;
+	  measurement.sort_buckets_time += timeit([&] {
+		parallel_radix_sort(chunk, run_measurement);
+	  });
+	}
 
-	  // finally, we can write the result.
-#pragma omp for schedule(static)
-	  for (int bucket_index = 0; bucket_index < no_buckets; bucket_index++) {
-		int start_idx = prefix_sum[bucket_index];
-		for (size_t i = 0; i < shared_buckets[bucket_index].size(); i++) {
-		  array[start_idx + i] = shared_buckets[bucket_index][i];
-		}
-	  }
+	measurement.write_sorted_buckets_time += timeit([&] {
+	  write_fully(output, chunk.data(), count, output_size * sizeof(double));
 	});
+	output_size += count;
+  }
+  close_run(run);
+}
 
-	// update measurements at the end.
-	if (tid == 0) {
-	  measurement.split_to_buckets_time = split_to_buckets_time;
-	  measurement.sort_buckets_time = sort_buckets_time;
-	  measurement.write_sorted_buckets_time = write_sorted_buckets_time;
+void out_of_core_sort(Measurement& measurement) {
+  MappedFile input = map_file(param_input_file);
+  if (param_output_file.empty()) {
+	param_output_file = param_input_file + ".sorted";
+  }
+
+  // 1. partition into runs by the range of values, found in a pass of its own.
+  std::vector<Run> runs;
+  measurement.split_to_buckets_time = timeit([&] {
+	double min = HUGE_VAL, max = -HUGE_VAL;
+	size_t non_finite = 0;
+#pragma omp parallel for schedule(static) reduction(min:min) reduction(max:max) reduction(+:non_finite) \
+	num_threads(param_threads)
+	for (size_t i = 0; i < input.size; i++) {
+	  if (std::isfinite(input.values[i])) {
+		min = std::min(min, input.values[i]);
+		max = std::max(max, input.values[i]);
+	  } else {
+		non_finite++;
+	  }
+	}
+	if (non_finite > 0) {
+	  log<INFO>("%s holds %zu NaN or infinite values\n", param_input_file.c_str(), non_finite);
+	  exit(1);
 	}
+
+	runs = partition_into_runs(input.values, input.size, min, max, runs_for(input.size), param_output_file);
+  });
+
+  int output = open(param_output_file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (output < 0) {
+	log<INFO>("Cannot create %s\n", param_output_file.c_str());
+	exit(1);
+  }
+
+  // 2. sort runs one at a time and append them to the output.
+  off_t output_size = 0;
+  for (auto& run : runs) {
+	sort_run(run, output, output_size, measurement);
   }
+  close(output);
+
+  double megabytes = input.bytes / (1024. * 1024.);
+  measurement.read_throughput = megabytes / measurement.split_to_buckets_time;
+  measurement.write_throughput = megabytes / measurement.write_sorted_buckets_time;
+
+  // 3. verify, a fingerprint of the input against the mapped output (also with --verify=full).
+  if (verification != Verification::none) {
+	Fingerprint input_fingerprint = fingerprint(input.values, input.size);
+	MappedFile sorted = map_file(param_output_file);
+	verify(sorted.values, sorted.size, input_fingerprint);
+	unmap_file(sorted);
+  }
+  unmap_file(input);
 }
 
 void log_generated_data(std::vector<double>& data) {
@@ -343,7 +2900,90 @@ void log_generated_data(std::vector<double>& data) {
   log<INFO>("%lf\n", data[data.size() - 1]);
 }
 
+// Phases as logged, generate is timed for the uniform distribution only.
+const int no_logged_phases = 4;
+const char* logged_phases[no_logged_phases] = {"generate", "split", "sort", "write"};
+
+std::vector<ThreadTime> phase_thread_times(const Measurement& measurement, int phase) {
+  if (phase == 0) {
+	return measurement.generate_thread_times;
+  }
+  std::vector<ThreadTime> result;
+  for (auto& times : measurement.thread_times) {
+	result.push_back(phase == 1 ? times.split : (phase == 2 ? times.sort : times.write));
+  }
+  return result;
+}
+
+// Memory use of every phase (--memory-stats=1), generate and verify included.
+const int no_memory_phases = 5;
+const char* memory_phases[no_memory_phases] = {"generate", "split", "sort", "write", "verify"};
+
+MemoryUsage phase_memory(const Measurement& measurement, int phase) {
+  if (phase == 0) {
+	return measurement.generate_memory;
+  }
+  if (phase == 4) {
+	return measurement.verify_memory;
+  }
+  return phase_memory_usage(phase_thread_times(measurement, phase));
+}
+
+// Allocations, allocated bytes and peak RSS as reported, all -1 when the phase was not sampled
+// (#7's write, v8 - v11's split and write, and so on) rather than zeros that look like measurements.
+void memory_values(const MemoryUsage& usage, long long* values) {
+  values[0] = usage.sampled ? (long long)usage.allocations : -1;
+  values[1] = usage.sampled ? (long long)usage.allocated_bytes : -1;
+  values[2] = usage.sampled ? (long long)usage.peak_rss : -1;
+}
+
+// Spread of a phase over threads (--log-format=2).
+// Imbalance is the slowest thread's work over the mean work, 1 when perfectly balanced.
+struct PhaseStatistics {
+  double work_min = 0.;
+  double work_mean = 0.;
+  double work_max = 0.;
+  double wait_mean = 0.;
+  double wait_max = 0.;
+  double imbalance = 1.;
+};
+
+PhaseStatistics phase_statistics(const std::vector<ThreadTime>& thread_times) {
+  PhaseStatistics statistics;
+  statistics.work_min = HUGE_VAL;
+  for (auto& time : thread_times) {
+	statistics.work_min = std::min(statistics.work_min, time.work);
+	statistics.work_max = std::max(statistics.work_max, time.work);
+	statistics.wait_max = std::max(statistics.wait_max, time.wait);
+	statistics.work_mean += time.work / thread_times.size();
+	statistics.wait_mean += time.wait / thread_times.size();
+  }
+  if (statistics.work_mean > 0.) {
+	statistics.imbalance = statistics.work_max / statistics.work_mean;
+  }
+  return statistics;
+}
+
+// A row of the long format (--log-format=2): bucket_size;threads;algorithm;phase;statistic;value
+void log_row(const char* phase, const char* statistic, double value) {
+  log<INFO>("%d;%d;%d;%s;%s;%lf\n", bucket_size, param_threads, param_algorithm_version, phase, statistic, value);
+}
+
+// counts, bytes and cpus are integers.
+void log_row(const char* phase, const char* statistic, long long value) {
+  log<INFO>("%d;%d;%d;%s;%s;%lld\n", bucket_size, param_threads, param_algorithm_version, phase, statistic, value);
+}
+
 void log_results(Measurement measurement) {
+  bool log_counters = parallel_sort::counter_reader() != nullptr;
+
+  // One row per measurement, the columns depend on the flags only, never on what was measured:
+  //   bucket_size;threads;algorithm;generating;splitting;sorting;writing;overall
+  //   --input:           ;read_throughput;write_throughput (MB/s)
+  //   --affinity:        ;cpus (of every thread, '/'-separated)
+  //   --counters=1:      ;5 counters of generate, split, sort and write each
+  //   --memory-stats=1:  ;allocations;allocated bytes;peak RSS of generate, split, sort, write and verify
+  // in this order, -1 for values that are unavailable or were not measured.
   if (log_format == 1) {
 	log<INFO>(
 		"%d;"
@@ -353,8 +2993,7 @@ void log_results(Measurement measurement) {
 		"%lf;"
 		"%lf;"
 		"%lf;"
-		"%lf"
-		"\n",
+		"%lf",
 		bucket_size,
 		param_threads,
 		param_algorithm_version,
@@ -363,11 +3002,539 @@ void log_results(Measurement measurement) {
 		measurement.sort_buckets_time,
 		measurement.write_sorted_buckets_time,
 		measurement.sort_time);
+
+	// out-of-core mode appends I/O throughput.
+	if (!param_input_file.empty()) {
+	  log<INFO>(";%lf;%lf", measurement.read_throughput, measurement.write_throughput);
+	}
+
+	// --affinity appends the cpu of every thread, -1 where unknown.
+	if (param_affinity != "none") {
+	  log<INFO>(";%s", format_thread_cpus(measurement.thread_cpus).c_str());
+	}
+
+	// --counters=1 appends every counter of every phase, summed over threads, -1 when unavailable,
+	// so the columns are the same whether the kernel grants the counters or not.
+	if (counters_flag) {
+	  for (int phase = 0; phase < no_logged_phases; phase++) {
+		long long sums[parallel_sort::max_counters];
+		counter_sums(phase_thread_times(measurement, phase), sums);
+		for (long long sum : sums) {
+		  log<INFO>(";%lld", sum);
+		}
+	  }
+	}
+
+	// --memory-stats=1 appends allocations, allocated bytes and peak RSS (bytes) of every phase,
+	// -1 for phases the algorithm does not have.
+	if (memory_stats_flag) {
+	  for (int phase = 0; phase < no_memory_phases; phase++) {
+		long long values[3];
+		memory_values(phase_memory(measurement, phase), values);
+		log<INFO>(";%lld;%lld;%lld", values[0], values[1], values[2]);
+	  }
+	}
+	log<INFO>("\n");
+  } else if (log_format == 2) {
+	log_row("generate", "time", measurement.rand_gen_time);
+	for (int phase = 0; phase < no_logged_phases; phase++) {
+	  std::vector<ThreadTime> thread_times = phase_thread_times(measurement, phase);
+	  if (thread_times.empty()) {
+		continue;
+	  }
+
+	  PhaseStatistics statistics = phase_statistics(thread_times);
+	  log_row(logged_phases[phase], "work_min", statistics.work_min);
+	  log_row(logged_phases[phase], "work_mean", statistics.work_mean);
+	  log_row(logged_phases[phase], "work_max", statistics.work_max);
+	  log_row(logged_phases[phase], "wait_mean", statistics.wait_mean);
+	  log_row(logged_phases[phase], "wait_max", statistics.wait_max);
+	  log_row(logged_phases[phase], "imbalance", statistics.imbalance);
+
+	  if (log_counters) {
+		long long sums[parallel_sort::max_counters];
+		counter_sums(thread_times, sums);
+		for (int counter = 0; counter < parallel_sort::max_counters; counter++) {
+		  if (counter_available[counter]) {
+			log_row(logged_phases[phase], counter_names[counter], sums[counter]);
+		  }
+		}
+	  }
+	}
+	log_row("overall", "time", measurement.sort_time);
+
+	if (memory_stats_flag) {
+	  for (int phase = 0; phase < no_memory_phases; phase++) {
+		long long values[3];
+		memory_values(phase_memory(measurement, phase), values);
+		log_row(memory_phases[phase], "allocations", values[0]);
+		log_row(memory_phases[phase], "allocated_bytes", values[1]);
+		log_row(memory_phases[phase], "peak_rss", values[2]);
+	  }
+	}
+
+	for (size_t i = 0; i < measurement.selected_ranks.size(); i++) {
+	  log_row("result", ("rank_" + std::to_string(measurement.selected_ranks[i])).c_str(), measurement.selected_values[i]);
+	}
+
+	// the cpu of every thread, -1 when unknown.
+	for (size_t thread = 0; thread < measurement.thread_cpus.size(); thread++) {
+	  log_row("mapping", ("thread_" + std::to_string(thread)).c_str(), (long long)measurement.thread_cpus[thread]);
+	}
   } else {
 	// Other formats
   }
 }
 
+// One repetition: generate, sort with the chosen algorithm and verify.
+Measurement measure(std::vector<double>& data) {
+  if (pipeline_flag && param_algorithm_version != 3) {
+	log<INFO>("Pipelined generation is available for algorithm #3 only\n");
+	exit(1);
+  }
+  if (pipeline_flag && param_mode != "sort") {
+	log<INFO>("Pipelined generation is available for --mode=sort only\n");
+	exit(1);
+  }
+  if (param_key_type != "double" && (param_mode != "sort" || (param_algorithm_version != 4 && param_algorithm_version != 5))) {
+	log<INFO>("Key types other than double are available for algorithms #4 and #5 with --mode=sort only\n");
+	exit(1);
+  }
+  if (param_batch > 0 && (pipeline_flag || param_mode != "sort" || param_algorithm_version != 4 || param_key_type != "double")) {
+	log<INFO>("Batches are available for algorithm #4 with --mode=sort and double keys only\n");
+	exit(1);
+  }
+
+  // pinned before the input's first touch, so its pages are placed by the threads that sort them.
+  pin_threads();
+  place(data);
+
+  Measurement measurement;
+  measurement.thread_cpus = thread_cpus();
+  measurement.thread_times.resize(param_threads);
+  if (param_distribution == "uniform" && !pipeline_flag) {
+	measurement.generate_thread_times.resize(param_threads);
+  }
+
+  // generation is part of the sort, the input never exists as a whole.
+  if (pipeline_flag) {
+	std::vector<double> data_copy;
+	Fingerprint data_fingerprint;
+	if (parallel_sort::memory_sampler() != nullptr) {
+	  MemoryUsage previous;  // the phases count from here
+	  parallel_sort::memory_sampler()(previous);
+	}
+	measurement.sort_time = timeit([&] {
+	  pipelined_bucket_sort(data, data_copy, data_fingerprint, measurement);
+	});
+
+	measurement.verify_memory = step_memory_usage([&] {
+	  if (verification == Verification::full) {
+		verify(data, data_copy);
+	  } else if (verification == Verification::fast) {
+		verify(data, data_fingerprint);
+	  }
+	});
+	return measurement;
+  }
+
+  // 1. generate data
+  measurement.generate_memory = step_memory_usage([&] {
+	measurement.rand_gen_time = timeit([&] {
+	  generate_data(data, &measurement.generate_thread_times);
+	});
+  });
+
+  // selection leaves the input as it is, which makes a copy for verification unnecessary.
+  if (param_mode != "sort") {
+	measurement.sort_time = timeit([&] {
+	  parallel_select(data, measurement);
+	});
+	measurement.verify_memory = step_memory_usage([&] {
+	  verify_selection(data, measurement);
+	});
+	return measurement;
+  }
+
+  // other key types are converted, sorted and verified on their own.
+  if (param_key_type != "double") {
+	sort_converted_keys(data, measurement);
+	return measurement;
+  }
+
+  // so are batches of independent arrays.
+  if (param_batch > 0) {
+	parallel_bucket_sort_4_batch(data, measurement);
+	return measurement;
+  }
+
+  // full verification needs a copy of the input, the fast one only a fingerprint,
+  // taken in an untimed pass of its own. Both count towards the memory use of verification.
+  std::vector<double> data_copy;
+  Fingerprint data_fingerprint;
+  measurement.verify_memory = step_memory_usage([&] {
+	if (verification == Verification::full) {
+	  data_copy = data;
+	} else if (verification == Verification::fast) {
+	  data_fingerprint = fingerprint(data);
+	}
+  });
+
+  // 2. sort using chosen algorithm
+  if (param_algorithm_version == 1) {
+	measurement.sort_time = timeit([&] {
+	  parallel_bucket_sort_1(data, measurement);
+	});
+  } else if (param_algorithm_version == 2) {
+	measurement.sort_time = timeit([&] {
+	  parallel_bucket_sort_2(data, measurement);
+	});
+  } else if (param_algorithm_version == 3) {
+	measurement.sort_time = timeit([&] {
+	  parallel_bucket_sort_3(data, measurement);
+	});
+  } else if (param_algorithm_version == 4) {
+	measurement.sort_time = timeit([&] {
+	  if (write_combining_flag) {
+		parallel_bucket_sort_4_wc(data, measurement);
+	  } else {
+		parallel_bucket_sort_4(data, measurement);
+	  }
+	});
+  } else if (param_algorithm_version == 5) {
+	measurement.sort_time = timeit([&] {
+	  parallel_radix_sort(data, measurement);
+	});
+  } else if (param_algorithm_version == 6) {
+	measurement.sort_time = timeit([&] {
+	  parallel_sample_sort(data, measurement);
+	});
+  } else if (param_algorithm_version == 7) {
+	measurement.sort_time = timeit([&] {
+	  parallel_bucket_sort_7(data, measurement);
+	});
+  } else if (param_algorithm_version == 8) {
+	measurement.sort_time = timeit([&] {
+	  library_sort(data);
+	});
+  } else if (param_algorithm_version == 9) {
+	measurement.sort_time = timeit([&] {
+	  gnu_parallel_sort(data);
+	});
+  } else if (param_algorithm_version == 10) {
+	measurement.sort_time = timeit([&] {
+	  par_unseq_sort(data);
+	});
+  } else if (param_algorithm_version == 11) {
+	measurement.sort_time = timeit([&] {
+	  sequential_bucket_sort(data, std::max(param_size / bucket_size, 1));
+	});
+  }
+
+  // the baselines have no phases, all of their memory use is the sort's.
+  if (param_algorithm_version >= 8 && parallel_sort::memory_sampler() != nullptr) {
+	parallel_sort::memory_sampler()(measurement.thread_times[0].sort.memory);
+  }
+
+  // 3. verify
+  measurement.verify_memory += step_memory_usage([&] {
+	if (verification == Verification::full) {
+	  verify(data, data_copy);
+	} else if (verification == Verification::fast) {
+	  verify(data, data_fingerprint);
+	}
+  });
+  return measurement;
+}
+
+// ------ Bucket size autotuning ----------
+// --bucket-size=auto picks the bucket size by timing a few candidates on a sample of the input
+// (the same distribution, at most autotune_sample_size elements) with the chosen algorithm.
+// Candidates double from 4 up to twice the L1 data cache, plus one bucket filling the L2 cache,
+// none larger than the sample. A sweep (--sweep) tunes every point on its own.
+// The winner is stored in --tuning-file per (machine, size class, threads, algorithm),
+// where the machine is the cpu model with its cache sizes and the size class is log2 of --size,
+// later runs with the same key take it from there without calibrating.
+
+const int autotune_sample_size = 1 << 19;
+const int autotune_repeats = 2;
+
+std::string machine_name(const CacheSizes& caches) {
+  std::string model = "unknown";
+  FILE* cpuinfo = std::fopen("/proc/cpuinfo", "r");
+  if (cpuinfo != nullptr) {
+	char line[512];
+	while (std::fgets(line, sizeof(line), cpuinfo) != nullptr) {
+	  if (std::strncmp(line, "model name", 10) == 0 && std::strchr(line, ':') != nullptr) {
+		model = std::string(std::strchr(line, ':') + 2, std::strcspn(std::strchr(line, ':') + 2, "\n"));
+		break;
+	  }
+	}
+	std::fclose(cpuinfo);
+  }
+  std::replace(model.begin(), model.end(), ';', ',');
+  return model + " L1d " + std::to_string(caches.l1d >> 10) + "K L2 " + std::to_string(caches.l2 >> 10) +
+		 "K L3 " + std::to_string(caches.l3 >> 10) + "K";
+}
+
+// "machine;size class;threads;algorithm", the last matching line of the tuning file wins.
+std::string tuning_key(const CacheSizes& caches) {
+  int size_class = 0;
+  while ((2 << size_class) <= param_size) {
+	size_class++;
+  }
+  return machine_name(caches) + ";" + std::to_string(size_class) + ";" + std::to_string(param_threads) + ";" +
+		 std::to_string(param_algorithm_version);
+}
+
+int read_tuned_bucket_size(const std::string& key) {
+  int tuned = 0;
+  FILE* file = std::fopen(param_tuning_file.c_str(), "r");
+  if (file == nullptr) {
+	return tuned;
+  }
+  char line[1024];
+  while (std::fgets(line, sizeof(line), file) != nullptr) {
+	std::string entry(line, std::strcspn(line, "\n"));
+	size_t separator = entry.rfind(';');
+	if (separator != std::string::npos && entry.compare(0, separator, key) == 0 && separator == key.size()) {
+	  tuned = std::atoi(entry.c_str() + separator + 1);
+	}
+  }
+  std::fclose(file);
+  return tuned;
+}
+
+// A bucket larger than the sample would leave no buckets at all.
+std::vector<int> bucket_size_candidates(const CacheSizes& caches, int sample_size) {
+  long largest = std::max(sample_size, 1);
+  std::vector<int> candidates;
+  for (long candidate = 4; candidate * (long)sizeof(double) <= 2 * caches.l1d && candidate <= largest; candidate *= 2) {
+	candidates.push_back(candidate);
+  }
+  long l2_bucket = std::min(caches.l2 / (long)sizeof(double), largest);
+  if (candidates.empty() || l2_bucket > candidates.back()) {
+	candidates.push_back(l2_bucket);
+  }
+  return candidates;
+}
+
+// Sets bucket_size, from the tuning file or by calibration.
+void autotune_bucket_size() {
+  CacheSizes caches = read_cache_sizes();
+  std::string key = tuning_key(caches);
+  int tuned = read_tuned_bucket_size(key);
+  if (tuned > 0) {
+	bucket_size = tuned;
+	return;
+  }
+
+  // the sample is sorted as a whole input of its own, unverified.
+  int size = param_size;
+  Verification verify = verification;
+  param_size = std::min(param_size, autotune_sample_size);
+  verification = Verification::none;
+  std::vector<double> sample(param_size);
+
+  double best_time = HUGE_VAL;
+  for (int candidate : bucket_size_candidates(caches, param_size)) {
+	bucket_size = candidate;
+	double time = HUGE_VAL;
+	measure(sample);
+	for (int i = 0; i < autotune_repeats; i++) {
+	  time = std::min(time, measure(sample).sort_time);
+	}
+	if (time < best_time) {
+	  best_time = time;
+	  tuned = candidate;
+	}
+  }
+  param_size = size;
+  verification = verify;
+  bucket_size = tuned;
+
+  FILE* file = std::fopen(param_tuning_file.c_str(), "a");
+  if (file != nullptr) {
+	std::fprintf(file, "%s;%d\n", key.c_str(), tuned);
+	std::fclose(file);
+  }
+}
+
+// ------ Sweep ----------
+// --sweep=<file> measures every combination of the --sweep-* lists in one process,
+// each point is warmed up (--warmup) and repeated (--repeat), and one tidy csv row
+// is written per point and phase:
+// size;threads;bucket_size;algorithm;schedule;affinity;cpus;phase;repeats;median;ci_low;ci_high
+// Lists are comma separated values or ranges first-last[:step], e.g. 1-8 or 1,2,4-16:4;
+// schedules are static, dynamic, guided or auto with an optional chunk size, e.g. dynamic:64;
+// affinities are --affinity policies, e.g. compact,scatter.
+
+std::vector<int> parse_list(const std::string& list) {
+  std::vector<int> values;
+  size_t position = 0;
+  while (position <= list.size()) {
+	size_t end = std::min(list.find(',', position), list.size());
+	std::string item = list.substr(position, end - position);
+	int first, last, step = 1;
+	if (std::sscanf(item.c_str(), "%d-%d:%d", &first, &last, &step) >= 2) {
+	  for (int value = first; value <= last; value += std::max(step, 1)) {
+		values.push_back(value);
+	  }
+	} else if (std::sscanf(item.c_str(), "%d", &first) == 1) {
+	  values.push_back(first);
+	} else {
+	  log<INFO>("Invalid list: %s\n", list.c_str());
+	  exit(1);
+	}
+	position = end + 1;
+  }
+  return values;
+}
+
+std::vector<std::string> parse_names(const std::string& list) {
+  std::vector<std::string> names;
+  size_t position = 0;
+  while (position <= list.size()) {
+	size_t end = std::min(list.find(',', position), list.size());
+	names.push_back(list.substr(position, end - position));
+	position = end + 1;
+  }
+  return names;
+}
+
+struct Schedule {
+  omp_sched_t kind;
+  int chunk_size;
+  std::string name;
+};
+
+std::vector<Schedule> parse_schedules(const std::string& list) {
+  std::vector<Schedule> schedules;
+  size_t position = 0;
+  while (position <= list.size()) {
+	size_t end = std::min(list.find(',', position), list.size());
+	std::string item = list.substr(position, end - position);
+	std::string kind = item.substr(0, item.find(':'));
+
+	Schedule schedule;
+	schedule.chunk_size = item.find(':') == std::string::npos ? 0 : std::atoi(item.c_str() + item.find(':') + 1);
+	schedule.name = schedule.chunk_size > 0 ? kind + "," + std::to_string(schedule.chunk_size) : kind;
+	if (kind == "static") {
+	  schedule.kind = omp_sched_static;
+	} else if (kind == "dynamic") {
+	  schedule.kind = omp_sched_dynamic;
+	} else if (kind == "guided") {
+	  schedule.kind = omp_sched_guided;
+	} else if (kind == "auto") {
+	  schedule.kind = omp_sched_auto;
+	} else {
+	  log<INFO>("Unknown schedule: %s\n", item.c_str());
+	  exit(1);
+	}
+	schedules.push_back(schedule);
+	position = end + 1;
+  }
+  return schedules;
+}
+
+// Median with a distribution-free 95% confidence interval from order statistics
+// (ranks n/2 -+ 1.96 sqrt(n)/2), min and max for fewer than 6 samples.
+struct Summary {
+  double median;
+  double ci_low;
+  double ci_high;
+};
+
+Summary summarize(std::vector<double> samples) {
+  std::sort(samples.begin(), samples.end());
+  int n = samples.size();
+
+  Summary summary;
+  summary.median = n % 2 == 1 ? samples[n / 2] : (samples[n / 2 - 1] + samples[n / 2]) / 2.;
+  int spread = (int)std::ceil(1.96 * std::sqrt(n) / 2.);
+  int low = n < 6 ? 0 : std::max(n / 2 - spread, 0);
+  int high = n < 6 ? n - 1 : std::min(n / 2 + spread, n - 1);
+  summary.ci_low = samples[low];
+  summary.ci_high = samples[high];
+  return summary;
+}
+
+void run_sweep() {
+  std::vector<int> sizes = parse_list(param_sweep_sizes.empty() ? std::to_string(param_size) : param_sweep_sizes);
+  std::vector<int> threads = parse_list(param_sweep_threads.empty() ? std::to_string(param_threads) : param_sweep_threads);
+  // --bucket-size=auto without --sweep-bucket-sizes tunes every point, 0 stands for it.
+  std::vector<int> bucket_sizes = parse_list(param_sweep_bucket_sizes.empty() ? std::to_string(autotune_flag ? 0 : bucket_size)
+																			  : param_sweep_bucket_sizes);
+  std::vector<int> versions = parse_list(param_sweep_versions.empty() ? std::to_string(param_algorithm_version) : param_sweep_versions);
+  std::vector<Schedule> schedules = parse_schedules(param_sweep_schedules.empty() ? param_schedule : param_sweep_schedules);
+  std::vector<std::string> affinities = parse_names(param_sweep_affinities.empty() ? param_affinity : param_sweep_affinities);
+
+  // a sweep goes on without the par_unseq baseline when the build lacks it.
+  if (!par_unseq_available() && std::find(versions.begin(), versions.end(), 10) != versions.end()) {
+	log<INFO>("std::execution::par_unseq is not available in this build (see make STD=-std=c++17), skipping version 10\n");
+	versions.erase(std::remove(versions.begin(), versions.end(), 10), versions.end());
+  }
+
+  FILE* output = std::fopen(param_sweep_file.c_str(), "w");
+  if (output == nullptr) {
+	log<INFO>("Cannot open %s\n", param_sweep_file.c_str());
+	exit(1);
+  }
+  std::fprintf(output, "size;threads;bucket_size;algorithm;schedule;affinity;cpus;phase;repeats;median;ci_low;ci_high\n");
+
+  for (int size : sizes) {
+	// one input buffer per size, placed again by every measurement for its team.
+	param_size = size;
+	std::vector<double> data(size);
+
+	for (int version : versions) {
+	  for (int bucket : bucket_sizes) {
+		for (int thread_count : threads) {
+		  for (auto& schedule : schedules) {
+			for (auto& affinity : affinities) {
+			  param_algorithm_version = version;
+			  bucket_size = bucket;
+			  param_threads = thread_count;
+			  omp_set_schedule(schedule.kind, schedule.chunk_size);
+			  param_affinity = affinity;
+			  parse_affinity(affinity);
+			  if (bucket == 0) {
+				autotune_bucket_size();
+			  }
+
+			  for (int i = 0; i < param_warmup; i++) {
+				measure(data);
+			  }
+
+			  std::vector<double> phase_samples[5];
+			  std::string cpu_mapping;
+			  for (int i = 0; i < param_repeat; i++) {
+				Measurement measurement = measure(data);
+				cpu_mapping = format_thread_cpus(measurement.thread_cpus);
+				phase_samples[0].push_back(measurement.rand_gen_time);
+				phase_samples[1].push_back(measurement.split_to_buckets_time);
+				phase_samples[2].push_back(measurement.sort_buckets_time);
+				phase_samples[3].push_back(measurement.write_sorted_buckets_time);
+				phase_samples[4].push_back(measurement.sort_time);
+			  }
+
+			  const char* phases[] = {"generate", "split", "sort", "write", "overall"};
+			  for (int phase = 0; phase < 5; phase++) {
+				Summary summary = summarize(phase_samples[phase]);
+				std::fprintf(output, "%d;%d;%d;%d;%s;%s;%s;%s;%d;%lf;%lf;%lf\n", size, thread_count, bucket_size, version,
+							 schedule.name.c_str(), affinity.c_str(), cpu_mapping.c_str(), phases[phase], param_repeat,
+							 summary.median, summary.ci_low, summary.ci_high);
+			  }
+			  std::fflush(output);
+			}
+		  }
+		}
+	  }
+	}
+  }
+  std::fclose(output);
+}
+
 int main(int, char* argv[]) {
   argh::parser cmdl(argv);
 
@@ -375,44 +3542,102 @@ int main(int, char* argv[]) {
   cmdl({"-s", "--size"}, param_size) >> param_size;
   cmdl({"-r", "--repeat"}, param_repeat) >> param_repeat;
   cmdl({"-v", "--version"}, param_algorithm_version) >> param_algorithm_version;
-  cmdl({"-b", "--bucket-size"}, bucket_size) >> bucket_size;
+  std::string param_bucket_size;
+  cmdl({"-b", "--bucket-size"}, std::to_string(bucket_size)) >> param_bucket_size;
+  autotune_flag = param_bucket_size == "auto";
+  if (!autotune_flag) {
+	bucket_size = std::atoi(param_bucket_size.c_str());
+	if (bucket_size <= 0) {
+	  log<INFO>("Invalid bucket size: %s\n", param_bucket_size.c_str());
+	  exit(1);
+	}
+  }
   cmdl({"-l", "--log-format"}, log_format) >> log_format;
   cmdl({"-g", "--sample-generator"}, sample_generator_flag) >> sample_generator_flag;
+  cmdl({"-w", "--write-combining"}, write_combining_flag) >> write_combining_flag;
+  cmdl({"-x", "--simd"}, simd_flag) >> simd_flag;
+  cmdl({"-p", "--pipeline"}, pipeline_flag) >> pipeline_flag;
+  cmdl({"-c", "--counters"}, counters_flag) >> counters_flag;
+  cmdl({"-a", "--tasks"}, tasks_flag) >> tasks_flag;
+  cmdl({"--memory-stats"}, memory_stats_flag) >> memory_stats_flag;
+  cmdl({"-d", "--distribution"}, param_distribution) >> param_distribution;
+  cmdl({"--seed"}, param_seed) >> param_seed;
+  cmdl({"--verify"}, param_verify) >> param_verify;
+  cmdl({"-i", "--input"}, param_input_file) >> param_input_file;
+  cmdl({"-o", "--output"}, param_output_file) >> param_output_file;
+  cmdl({"-m", "--memory"}, param_memory_mb) >> param_memory_mb;
+  cmdl({"--generate-file"}, param_generate_file) >> param_generate_file;
+  cmdl({"-k", "--key-type"}, param_key_type) >> param_key_type;
+  cmdl({"--schedule"}, param_schedule) >> param_schedule;
+  cmdl({"--sweep"}, param_sweep_file) >> param_sweep_file;
+  cmdl({"--sweep-sizes"}, param_sweep_sizes) >> param_sweep_sizes;
+  cmdl({"--sweep-threads"}, param_sweep_threads) >> param_sweep_threads;
+  cmdl({"--sweep-bucket-sizes"}, param_sweep_bucket_sizes) >> param_sweep_bucket_sizes;
+  cmdl({"--sweep-versions"}, param_sweep_versions) >> param_sweep_versions;
+  cmdl({"--sweep-schedules"}, param_sweep_schedules) >> param_sweep_schedules;
+  cmdl({"--sweep-affinities"}, param_sweep_affinities) >> param_sweep_affinities;
+  cmdl({"--warmup"}, param_warmup) >> param_warmup;
+  cmdl({"--batch"}, param_batch) >> param_batch;
+  cmdl({"--placement"}, param_placement) >> param_placement;
+  cmdl({"--affinity"}, param_affinity) >> param_affinity;
+  cmdl({"--tuning-file"}, param_tuning_file) >> param_tuning_file;
+  cmdl({"--mode"}, param_mode) >> param_mode;
+  cmdl({"--k"}, param_k) >> param_k;
+  cmdl({"--rank"}, param_rank) >> param_rank;
+  cmdl({"--quantiles"}, param_quantiles) >> param_quantiles;
+
+  parallel_sort::simd_enabled() = simd_flag;
+  parallel_sort::task_sort_enabled() = tasks_flag;
+  parse_placement(param_placement);
+  parse_verification(param_verify);
+  parse_affinity(param_affinity);
+
+  Schedule schedule = parse_schedules(param_schedule).front();
+  omp_set_schedule(schedule.kind, schedule.chunk_size);
+
+  if (counters_flag && !setup_hardware_counters()) {
+	log<INFO>("Hardware counters are not available, reporting timing only\n");
+  }
 
-  if (sample_generator_flag) {
-	std::vector<double> data(param_size);
-	uniform_fill(data);
-	log_generated_data(data);
+  if (memory_stats_flag) {
+	setup_memory_statistics();
+  }
 
+  if (!param_generate_file.empty()) {
+	generate_file(param_generate_file);
 	return 0;
   }
 
-  for (int i = 0; i < param_repeat; i++) {
-	std::vector<double> data(param_size);
+  if (!param_input_file.empty()) {
 	Measurement measurement;
-
-	// 1. generate data
-	measurement.rand_gen_time = timeit([&] {
-	  uniform_fill(data);
+	measurement.sort_time = timeit([&] {
+	  out_of_core_sort(measurement);
 	});
-	auto data_copy = data;
+	log_results(measurement);
+	return 0;
+  }
 
-	// 2. sort using chosen algorithm
-	if (param_algorithm_version == 1) {
-	  measurement.sort_time = timeit([&] {
-		parallel_bucket_sort_1(data, measurement);
-	  });
-	} else if (param_algorithm_version == 3) {
-	  measurement.sort_time = timeit([&] {
-		parallel_bucket_sort_3(data, measurement);
-	  });
-	}
+  if (sample_generator_flag) {
+	std::vector<double> data(param_size);
+	generate_data(data);
+	log_generated_data(data);
+
+	return 0;
+  }
 
-	// 3. verify
-	verify(data, data_copy);
+  if (!param_sweep_file.empty()) {
+	run_sweep();
+	return 0;
+  }
 
-	// 4. log results,
-	log_results(measurement);
+  // the out-of-core sort has no bucket size to tune, a sweep tunes every point.
+  if (autotune_flag) {
+	autotune_bucket_size();
+  }
+
+  for (int i = 0; i < param_repeat; i++) {
+	std::vector<double> data(param_size);
+	log_results(measure(data));
   }
 
   return 0;
@@ -16,4 +16,7 @@ function measure_alg() {
   done
 }
 
+measure_alg 2
 measure_alg 3
+measure_alg 4
+measure_alg 5
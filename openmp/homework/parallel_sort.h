@@ -0,0 +1,1230 @@
+#ifndef PARALLEL_SORT_H
+#define PARALLEL_SORT_H
+
+#include <vector>
+#include <algorithm>
+#include <memory>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <omp.h>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+// Header-only parallel sorting engines extracted from measure.cpp:
+// - count-then-scatter bucket sort (algorithm #4), also as a reusable BucketSorter,
+// - LSD radix sort (algorithm #5),
+// - argsort on top of the radix sort.
+// - Philox4x32-10 counter-based uniform doubles, the same for any number of threads (or ranks).
+// - an order-independent multiset fingerprint for verification.
+//
+// Engines are templated on the element type and on a key extraction functor,
+// so records with payloads are sorted by their key. Keys can be
+// float, double, int32_t, int64_t, uint32_t or uint64_t.
+// Phase times are reported through an optional PhaseTimes.
+
+namespace parallel_sort {
+
+// ------ Settings and CPU features ----------
+
+// Turns every SIMD path off when false.
+inline bool& simd_enabled() {
+  static bool enabled = true;
+  return enabled;
+}
+
+// Sorts buckets with tasks instead of a worksharing loop when true, see sort_buckets_tasks.
+inline bool& task_sort_enabled() {
+  static bool enabled = false;
+  return enabled;
+}
+
+#if defined(__x86_64__)
+
+inline bool cpu_has_avx2() {
+  static bool supported = __builtin_cpu_supports("avx2");
+  return simd_enabled() && supported;
+}
+
+inline bool cpu_has_avx512() {
+  static bool supported = __builtin_cpu_supports("avx512f");
+  return simd_enabled() && supported;
+}
+
+#else
+
+inline bool cpu_has_avx2() { return false; }
+inline bool cpu_has_avx512() { return false; }
+
+#endif
+
+const int max_counters = 5;
+
+// Reads the calling thread's event counters into values[max_counters],
+// installed by the application (e.g. hardware counters), nullptr when there are none.
+typedef void (*CounterReader)(uint64_t* values);
+
+inline CounterReader& counter_reader() {
+  static CounterReader reader = nullptr;
+  return reader;
+}
+
+// Process-wide memory use over a phase: allocations, bytes allocated
+// and the peak resident set size in bytes.
+struct MemoryUsage {
+  uint64_t allocations = 0;
+  uint64_t allocated_bytes = 0;
+  uint64_t peak_rss = 0;
+  bool sampled = false;  // set by the sampler, false for phases an algorithm does not have
+
+  MemoryUsage& operator+=(const MemoryUsage& other) {
+	allocations += other.allocations;
+	allocated_bytes += other.allocated_bytes;
+	peak_rss = std::max(peak_rss, other.peak_rss);
+	sampled |= other.sampled;
+	return *this;
+  }
+};
+
+// Reads the memory use of the process since the previous call and starts a new interval,
+// installed by the application (e.g. --memory-stats), nullptr when there is none.
+// Called by thread 0 only, after the closing barrier of a phase: anything between two phases
+// (allocating buffers before the parallel region, say) counts towards the later one.
+typedef void (*MemorySampler)(MemoryUsage& usage);
+
+inline MemorySampler& memory_sampler() {
+  static MemorySampler sampler = nullptr;
+  return sampler;
+}
+
+// Time one thread spent in a phase: working,
+// and waiting for the other threads at the barrier closing the phase.
+// Counters cover the work only, memory (thread 0 only) the whole phase, see MemorySampler.
+struct ThreadTime {
+  double work = 0.;
+  double wait = 0.;
+  uint64_t counters[max_counters] = {};
+  MemoryUsage memory;
+
+  double total() const { return work + wait; }
+
+  ThreadTime& operator+=(const ThreadTime& other) {
+	work += other.work;
+	wait += other.wait;
+	for (int i = 0; i < max_counters; i++) {
+	  counters[i] += other.counters[i];
+	}
+	memory += other.memory;
+	return *this;
+  }
+};
+
+struct ThreadPhaseTimes {
+  ThreadTime split;
+  ThreadTime sort;
+  ThreadTime write;
+};
+
+// Phase times of thread 0 (including its waits), and of every thread.
+struct PhaseTimes {
+  double split = 0.;
+  double sort = 0.;
+  double write = 0.;
+  std::vector<ThreadPhaseTimes> threads;
+};
+
+template<typename Function>
+inline double timed(Function&& timed_function) {
+  double time_0 = omp_get_wtime();
+  timed_function();
+  return omp_get_wtime() - time_0;
+}
+
+// Called from within a parallel region. The phase must not end with an implicit barrier (nowait),
+// the closing barrier is issued here and the time spent waiting at it is reported separately.
+// Barriers inside of the phase count as work.
+template<typename Function>
+inline ThreadTime timed_phase(Function&& timed_function) {
+  ThreadTime time;
+  CounterReader reader = counter_reader();
+  MemorySampler sampler = omp_get_thread_num() == 0 ? memory_sampler() : nullptr;
+  uint64_t before[max_counters], after[max_counters];
+  if (reader != nullptr) {
+	reader(before);
+  }
+  time.work = timed(timed_function);
+  if (reader != nullptr) {
+	reader(after);
+	for (int i = 0; i < max_counters; i++) {
+	  time.counters[i] = after[i] - before[i];
+	}
+  }
+  time.wait = timed([] {
+#pragma omp barrier
+  });
+  if (sampler != nullptr) {
+	sampler(time.memory);
+  }
+  return time;
+}
+
+// Called by every thread at the end of a parallel region, times.threads is sized beforehand.
+inline void record_thread_times(PhaseTimes& times, const ThreadTime& split, const ThreadTime& sort,
+								const ThreadTime& write) {
+  int tid = omp_get_thread_num();
+  if (tid == 0) {
+	times.split = split.total();
+	times.sort = sort.total();
+	times.write = write.total();
+  }
+  times.threads[tid].split = split;
+  times.threads[tid].sort = sort;
+  times.threads[tid].write = write;
+}
+
+// ------ Keys ----------
+
+struct Identity {
+  template<typename T>
+  const T& operator()(const T& value) const {
+	return value;
+  }
+};
+
+// Bits: unsigned integer ordered the same way as the key.
+template<typename Key>
+struct KeyTraits;
+
+template<>
+struct KeyTraits<double> {
+  typedef uint64_t Bits;
+  static Bits to_bits(double key) {
+	Bits bits;
+	std::memcpy(&bits, &key, sizeof(bits));
+	return (bits & (1ull << 63)) ? ~bits : bits | (1ull << 63);
+  }
+};
+
+template<>
+struct KeyTraits<float> {
+  typedef uint32_t Bits;
+  static Bits to_bits(float key) {
+	Bits bits;
+	std::memcpy(&bits, &key, sizeof(bits));
+	return (bits & (1u << 31)) ? ~bits : bits | (1u << 31);
+  }
+};
+
+template<>
+struct KeyTraits<int32_t> {
+  typedef uint32_t Bits;
+  static Bits to_bits(int32_t key) { return (Bits)key ^ (1u << 31); }
+};
+
+template<>
+struct KeyTraits<int64_t> {
+  typedef uint64_t Bits;
+  static Bits to_bits(int64_t key) { return (Bits)key ^ (1ull << 63); }
+};
+
+template<>
+struct KeyTraits<uint32_t> {
+  typedef uint32_t Bits;
+  static Bits to_bits(uint32_t key) { return key; }
+};
+
+template<>
+struct KeyTraits<uint64_t> {
+  typedef uint64_t Bits;
+  static Bits to_bits(uint64_t key) { return key; }
+};
+
+template<typename T, typename KeyOf>
+struct KeyOfType {
+  typedef typename std::decay<decltype(std::declval<KeyOf>()(std::declval<const T&>()))>::type type;
+};
+
+// ------ Prefix sums ----------
+
+// Exclusive prefix sum over per-thread counts laid out as counts[thread_id * no_buckets + bucket_index],
+// taken over buckets (outer) and threads (inner). Counts are replaced with write cursors
+// and bucket_start[bucket_index] receives the first index of every bucket.
+// Called from within a parallel region.
+inline void parallel_counts_prefix_sum(std::vector<int>& counts,
+									   std::vector<int>& prefix_sum_z,
+									   std::vector<int>& bucket_start,
+									   int no_buckets) {
+  int tid = omp_get_thread_num();
+  int threads = omp_get_num_threads();
+
+  // first every thread sums its share of buckets across all threads,
+  int sum = 0;
+#pragma omp for schedule(static)
+  for (int bucket_index = 0; bucket_index < no_buckets; bucket_index++) {
+	for (int thread_id = 0; thread_id < threads; thread_id++) {
+	  sum += counts[(size_t)thread_id * no_buckets + bucket_index];
+	}
+  }
+  prefix_sum_z[tid + 1] = sum;
+
+#pragma omp barrier
+  int offset = 0;
+  for (int i = 0; i < (tid + 1); i++) {
+	offset += prefix_sum_z[i];
+  }
+
+  // then turns counts into exclusive write cursors starting at its offset.
+#pragma omp for schedule(static)
+  for (int bucket_index = 0; bucket_index < no_buckets; bucket_index++) {
+	bucket_start[bucket_index] = offset;
+	for (int thread_id = 0; thread_id < threads; thread_id++) {
+	  int& count = counts[(size_t)thread_id * no_buckets + bucket_index];
+	  int cursor = offset;
+	  offset += count;
+	  count = cursor;
+	}
+  }
+}
+
+// ------ SIMD kernels ----------
+// - vectorized bucket index computation
+// - sorting network for small buckets
+// AVX2 / AVX-512 variants are compiled with target attributes
+// and chosen at runtime, with a scalar fallback.
+
+const int index_block_size = 256;
+const int small_bucket_threshold = 64;
+
+// Bucket of a key in [min, max), keys outside of it go to the first or the last bucket, NaN to the first.
+// Clamped before the conversion, which overflows for keys far outside of the range.
+template<typename Key>
+inline int bucket_index(Key key, int no_buckets, double min, double max) {
+  double scaled = no_buckets * ((double)key - min) / (max - min);
+  return (int)std::min(std::max(0., scaled), (double)(no_buckets - 1));
+}
+
+#if defined(__x86_64__)
+
+// same operations as the scalar formula (subtract, multiply, divide, clamp), so results are bit-identical.
+// max_pd returns its second operand when either is NaN, as std::max(0., scaled) does.
+__attribute__((target("avx2")))
+inline int bucket_indices_avx2(const double* values, int count, int* indices, int no_buckets, double min, double max) {
+  __m256d buckets = _mm256_set1_pd(no_buckets);
+  __m256d low = _mm256_set1_pd(min);
+  __m256d divisor = _mm256_set1_pd(max - min);
+  __m256d first_bucket = _mm256_setzero_pd();
+  __m256d last_bucket = _mm256_set1_pd(no_buckets - 1);
+
+  int i = 0;
+  for (; i + 4 <= count; i += 4) {
+	__m256d offset = _mm256_sub_pd(_mm256_loadu_pd(&values[i]), low);
+	__m256d scaled = _mm256_div_pd(_mm256_mul_pd(buckets, offset), divisor);
+	__m256d clamped = _mm256_min_pd(_mm256_max_pd(scaled, first_bucket), last_bucket);
+	_mm_storeu_si128((__m128i*)&indices[i], _mm256_cvttpd_epi32(clamped));
+  }
+  return i;
+}
+
+__attribute__((target("avx512f")))
+inline int bucket_indices_avx512(const double* values, int count, int* indices, int no_buckets, double min, double max) {
+  __m512d buckets = _mm512_set1_pd(no_buckets);
+  __m512d low = _mm512_set1_pd(min);
+  __m512d divisor = _mm512_set1_pd(max - min);
+  __m512d first_bucket = _mm512_setzero_pd();
+  __m512d last_bucket = _mm512_set1_pd(no_buckets - 1);
+
+  int i = 0;
+  for (; i + 8 <= count; i += 8) {
+	__m512d offset = _mm512_sub_pd(_mm512_loadu_pd(&values[i]), low);
+	__m512d scaled = _mm512_div_pd(_mm512_mul_pd(buckets, offset), divisor);
+	__m512d clamped = _mm512_min_pd(_mm512_max_pd(scaled, first_bucket), last_bucket);
+	_mm256_storeu_si256((__m256i*)&indices[i], _mm512_cvttpd_epi32(clamped));
+  }
+  return i;
+}
+
+// Bitonic sorting network over 4 <= size <= small_bucket_threshold elements (power of two).
+// Every merge stage starts with a flip (i against block_end - i), after which
+// all compare-exchanges are ascending, so each step is a plain min/max.
+__attribute__((target("avx2")))
+inline void bitonic_sort_avx2(double* values, int size) {
+  for (int k = 2; k <= size; k *= 2) {
+	int half = k / 2;
+
+	// flip step.
+	if (half >= 4) {
+	  for (int base = 0; base < size; base += k) {
+		for (int t = 0; t < half; t += 4) {
+		  double* low = &values[base + t];
+		  double* high = &values[base + k - 4 - t];
+		  __m256d a = _mm256_loadu_pd(low);
+		  __m256d b = _mm256_permute4x64_pd(_mm256_loadu_pd(high), 0x1B);
+		  _mm256_storeu_pd(low, _mm256_min_pd(a, b));
+		  _mm256_storeu_pd(high, _mm256_permute4x64_pd(_mm256_max_pd(a, b), 0x1B));
+		}
+	  }
+	} else {
+	  for (int base = 0; base < size; base += 4) {
+		__m256d a = _mm256_loadu_pd(&values[base]);
+		__m256d b = half == 2 ? _mm256_permute4x64_pd(a, 0x1B) : _mm256_permute_pd(a, 0x5);
+		__m256d low = _mm256_min_pd(a, b), high = _mm256_max_pd(a, b);
+		_mm256_storeu_pd(&values[base], half == 2 ? _mm256_blend_pd(low, high, 0xC) : _mm256_blend_pd(low, high, 0xA));
+	  }
+	}
+
+	// half cleaners across vectors.
+	int j = half / 2;
+	for (; j >= 4; j /= 2) {
+	  for (int base = 0; base < size; base += 2 * j) {
+		for (int t = 0; t < j; t += 4) {
+		  __m256d a = _mm256_loadu_pd(&values[base + t]);
+		  __m256d b = _mm256_loadu_pd(&values[base + t + j]);
+		  _mm256_storeu_pd(&values[base + t], _mm256_min_pd(a, b));
+		  _mm256_storeu_pd(&values[base + t + j], _mm256_max_pd(a, b));
+		}
+	  }
+	}
+
+	// and the last two within a vector.
+	if (j >= 1) {
+	  for (int base = 0; base < size; base += 4) {
+		__m256d a = _mm256_loadu_pd(&values[base]);
+		if (j == 2) {
+		  __m256d b = _mm256_permute2f128_pd(a, a, 0x1);
+		  a = _mm256_blend_pd(_mm256_min_pd(a, b), _mm256_max_pd(a, b), 0xC);
+		}
+		__m256d b = _mm256_permute_pd(a, 0x5);
+		a = _mm256_blend_pd(_mm256_min_pd(a, b), _mm256_max_pd(a, b), 0xA);
+		_mm256_storeu_pd(&values[base], a);
+	  }
+	}
+  }
+}
+
+#endif
+
+// Bucket indices of count consecutive elements.
+template<typename T, typename KeyOf>
+void compute_bucket_indices(const T* values, int count, int* indices, int no_buckets,
+							double min, double max, const KeyOf& key_of) {
+  for (int i = 0; i < count; i++) {
+	indices[i] = bucket_index(key_of(values[i]), no_buckets, min, max);
+  }
+}
+
+// plain doubles take the vectorized path.
+inline void compute_bucket_indices(const double* values, int count, int* indices, int no_buckets,
+								   double min, double max, const Identity& = Identity()) {
+  int i = 0;
+#if defined(__x86_64__)
+  if (cpu_has_avx512()) {
+	i = bucket_indices_avx512(values, count, indices, no_buckets, min, max);
+  } else if (cpu_has_avx2()) {
+	i = bucket_indices_avx2(values, count, indices, no_buckets, min, max);
+  }
+#endif
+  for (; i < count; i++) {
+	indices[i] = bucket_index(values[i], no_buckets, min, max);
+  }
+}
+
+// Sorts a single bucket by key.
+template<typename T, typename KeyOf>
+void sort_bucket(T* first, T* last, const KeyOf& key_of) {
+  std::sort(first, last, [&](const T& a, const T& b) { return key_of(a) < key_of(b); });
+}
+
+// Small buckets of plain doubles are padded with +inf and go through the sorting network.
+inline void sort_bucket(double* first, double* last, const Identity& = Identity()) {
+  int size = last - first;
+  if (size < 2) {
+	return;
+  }
+#if defined(__x86_64__)
+  if (size <= small_bucket_threshold && cpu_has_avx2()) {
+	int padded_size = 4;
+	while (padded_size < size) {
+	  padded_size *= 2;
+	}
+	double padded[small_bucket_threshold];
+	std::copy(first, last, padded);
+	std::fill(padded + size, padded + padded_size, HUGE_VAL);
+	bitonic_sort_avx2(padded, padded_size);
+	std::copy(padded, padded + size, first);
+	return;
+  }
+#endif
+  std::sort(first, last);
+}
+
+// ------ Task-parallel bucket sorting ----------
+// A static loop over buckets leaves one thread sorting an oversized bucket (skewed keys,
+// few buckets) while the others idle. With tasks, large buckets are split by quicksort
+// partitioning into tasks of their own and small ones are grouped into tasks of bounded size,
+// idle threads steal whatever is left.
+
+// Ranges of at least this many elements are partitioned further.
+const int task_split_threshold = 1 << 14;
+
+// Consecutive small buckets are grouped into tasks of about this many elements.
+const int task_batch_size = 1 << 13;
+
+// Three-way partitioning around a median of three, the part below the pivot becomes a task
+// and the part above is handled by the calling task, equal keys are already in place.
+template<typename T, typename KeyOf>
+void sort_range_tasks(T* first, T* last, const KeyOf& key_of) {
+  while (last - first >= task_split_threshold) {
+	auto a = key_of(first[0]), b = key_of(first[(last - first) / 2]), c = key_of(last[-1]);
+	auto pivot = std::max(std::min(a, b), std::min(std::max(a, b), c));
+	T* less_end = std::partition(first, last, [&](const T& value) { return key_of(value) < pivot; });
+	T* equal_end = std::partition(less_end, last, [&](const T& value) { return !(pivot < key_of(value)); });
+
+#pragma omp task
+	sort_range_tasks(first, less_end, key_of);
+
+	first = equal_end;
+  }
+  sort_bucket(first, last, key_of);
+}
+
+// One task sorting the buckets [first_bucket, last_bucket).
+template<typename BucketRange, typename KeyOf>
+void sort_bucket_batch_task(int first_bucket, int last_bucket, const BucketRange& bucket, const KeyOf& key_of) {
+  if (first_bucket == last_bucket) {
+	return;
+  }
+
+#pragma omp task
+  for (int bucket_index = first_bucket; bucket_index < last_bucket; bucket_index++) {
+	auto range = bucket(bucket_index);
+	sort_bucket(range.first, range.second, key_of);
+  }
+}
+
+// Called by every thread of a team in place of a loop over buckets,
+// bucket(bucket_index) gives the (first, last) pointers of a bucket.
+// A single thread creates the tasks, the others run them in the barrier of the
+// single construct, so all tasks are done on return and there is no wait left
+// at the end of the phase: load imbalance shows as longer work instead.
+template<typename BucketRange, typename KeyOf = Identity>
+void sort_buckets_tasks(int no_buckets, const BucketRange& bucket, const KeyOf& key_of = KeyOf()) {
+#pragma omp single
+  {
+	int batch_first = 0;
+	long long batch_size = 0;
+	for (int bucket_index = 0; bucket_index < no_buckets; bucket_index++) {
+	  auto range = bucket(bucket_index);
+	  long long size = range.second - range.first;
+	  bool large = size >= task_split_threshold;
+
+	  if (large || batch_size + size > task_batch_size) {
+		sort_bucket_batch_task(batch_first, bucket_index, bucket, key_of);
+		batch_first = bucket_index;
+		batch_size = 0;
+	  }
+
+	  if (large) {
+#pragma omp task
+		sort_range_tasks(range.first, range.second, key_of);
+		batch_first = bucket_index + 1;
+	  } else {
+		batch_size += size;
+	  }
+	}
+	sort_bucket_batch_task(batch_first, no_buckets, bucket, key_of);
+  }
+}
+
+// ------ Bucket sort ----------
+
+// Buffers of the bucket sort, grown on demand and kept between sorts.
+template<typename T>
+struct BucketSortWorkspace {
+  // flat buffer holding all buckets back to back.
+  std::unique_ptr<T[]> output;
+  size_t capacity = 0;
+
+  // counts[tid * no_buckets + bucket_index], turned into write cursors after prefix sum.
+  std::vector<int> counts;
+
+  // bucket_start[bucket_index] is the first index of a bucket in output.
+  std::vector<int> bucket_start;
+  std::vector<int> prefix_sum_z;
+
+  void reserve(size_t size, int no_buckets, int threads) {
+	if (capacity < size) {
+	  output.reset(new T[size]);
+	  capacity = size;
+	}
+	counts.resize((size_t)threads * no_buckets);
+	bucket_start.resize(no_buckets + 1);
+	prefix_sum_z.resize(threads + 1);
+  }
+};
+
+// Count-then-scatter bucket sort of keys in [min, max).
+// Each thread builds a histogram of its chunk of the array,
+// a parallel prefix sum over (bucket, thread) counts gives every thread
+// its own write cursor per bucket, and elements are scattered
+// straight into one flat buffer where buckets are then sorted in place.
+// Called by every thread of a team, the workspace is reserved beforehand
+// and times->threads (when given) is sized for the team.
+template<int NoBuckets = 0, typename T, typename KeyOf>
+void bucket_sort_team(T* array, int size, double min, double max, int no_buckets,
+					  BucketSortWorkspace<T>& workspace, const KeyOf& key_of, PhaseTimes* times) {
+  if (NoBuckets > 0) {
+	no_buckets = NoBuckets;
+  }
+
+  int tid = omp_get_thread_num();
+  T* output = workspace.output.get();
+  std::vector<int>& bucket_start = workspace.bucket_start;
+  int* my_counts = &workspace.counts[(size_t)tid * no_buckets];
+  std::fill(my_counts, my_counts + no_buckets, 0);
+
+  ThreadTime split_time = timed_phase([&] {
+
+	// each thread counts elements of its chunk per bucket,
+	// bucket indices are computed a block at a time.
+	int indices[index_block_size];
+	int no_blocks = (size + index_block_size - 1) / index_block_size;
+#pragma omp for schedule(static)
+	for (int block = 0; block < no_blocks; block++) {
+	  int first = block * index_block_size;
+	  int count = std::min(index_block_size, size - first);
+	  compute_bucket_indices(&array[first], count, indices, no_buckets, min, max, key_of);
+	  for (int j = 0; j < count; j++) {
+		my_counts[indices[j]]++;
+	  }
+	}
+
+	// counts become per-thread write cursors.
+	parallel_counts_prefix_sum(workspace.counts, workspace.prefix_sum_z, bucket_start, no_buckets);
+
+#pragma omp single
+	bucket_start[no_buckets] = size;
+
+	// static schedule hands every thread the same chunk as in the counting pass,
+	// so each thread scatters into the slots it has counted.
+#pragma omp for schedule(static) nowait
+	for (int block = 0; block < no_blocks; block++) {
+	  int first = block * index_block_size;
+	  int count = std::min(index_block_size, size - first);
+	  compute_bucket_indices(&array[first], count, indices, no_buckets, min, max, key_of);
+	  for (int j = 0; j < count; j++) {
+		output[my_counts[indices[j]]++] = array[first + j];
+	  }
+	}
+  });
+
+  // now each thread sorts its share of buckets within the flat buffer.
+  ThreadTime sort_time = timed_phase([&] {
+	if (task_sort_enabled()) {
+	  sort_buckets_tasks(no_buckets, [&](int bucket_index) {
+		return std::make_pair(&output[bucket_start[bucket_index]], &output[bucket_start[bucket_index + 1]]);
+	  }, key_of);
+	} else {
+#pragma omp for schedule(static) nowait
+	  for (int bucket_index = 0; bucket_index < no_buckets; bucket_index++) {
+		sort_bucket(&output[bucket_start[bucket_index]], &output[bucket_start[bucket_index + 1]], key_of);
+	  }
+	}
+  });
+
+  // buckets already sit in their final order, we only copy them back.
+  ThreadTime write_time = timed_phase([&] {
+#pragma omp for schedule(static) nowait
+	for (int i = 0; i < size; i++) {
+	  array[i] = output[i];
+	}
+  });
+
+  if (times != nullptr) {
+	record_thread_times(*times, split_time, sort_time, write_time);
+  }
+}
+
+// The same algorithm by the calling thread alone.
+template<typename T, typename KeyOf>
+void bucket_sort_sequential(T* array, int size, double min, double max, int no_buckets,
+							BucketSortWorkspace<T>& workspace, const KeyOf& key_of) {
+  workspace.reserve(size, no_buckets, 1);
+  T* output = workspace.output.get();
+  int* counts = workspace.counts.data();
+  int* bucket_start = workspace.bucket_start.data();
+  std::fill(counts, counts + no_buckets, 0);
+
+  int indices[index_block_size];
+  for (int first = 0; first < size; first += index_block_size) {
+	int count = std::min(index_block_size, size - first);
+	compute_bucket_indices(&array[first], count, indices, no_buckets, min, max, key_of);
+	for (int j = 0; j < count; j++) {
+	  counts[indices[j]]++;
+	}
+  }
+
+  int offset = 0;
+  for (int bucket_index = 0; bucket_index < no_buckets; bucket_index++) {
+	bucket_start[bucket_index] = offset;
+	offset += counts[bucket_index];
+	counts[bucket_index] = bucket_start[bucket_index];
+  }
+  bucket_start[no_buckets] = size;
+
+  for (int first = 0; first < size; first += index_block_size) {
+	int count = std::min(index_block_size, size - first);
+	compute_bucket_indices(&array[first], count, indices, no_buckets, min, max, key_of);
+	for (int j = 0; j < count; j++) {
+	  output[counts[indices[j]]++] = array[first + j];
+	}
+  }
+
+  for (int bucket_index = 0; bucket_index < no_buckets; bucket_index++) {
+	sort_bucket(&output[bucket_start[bucket_index]], &output[bucket_start[bucket_index + 1]], key_of);
+  }
+  std::copy(output, output + size, array);
+}
+
+// NoBuckets fixes the number of buckets at compile time, no_buckets is used when it is 0.
+template<int NoBuckets = 0, typename T, typename KeyOf = Identity>
+void bucket_sort(std::vector<T>& array, double min, double max, int no_buckets, int threads,
+				 KeyOf key_of = KeyOf(), PhaseTimes* times = nullptr) {
+  no_buckets = std::max(NoBuckets > 0 ? NoBuckets : no_buckets, 1);
+
+  BucketSortWorkspace<T> workspace;
+  workspace.reserve(array.size(), no_buckets, threads);
+  if (times != nullptr) {
+	times->threads.assign(threads, ThreadPhaseTimes());
+  }
+
+#pragma omp parallel num_threads(threads)
+  bucket_sort_team<NoBuckets>(array.data(), (int)array.size(), min, max, no_buckets, workspace, key_of, times);
+}
+
+// Arrays of at least this many elements are split between all threads of a batch.
+const int team_sort_threshold = 1 << 16;
+
+// Bucket sorter keeping its buffers between sorts, for sorting many arrays in a row.
+// sort_batch handles a whole batch in one parallel region: large arrays are sorted
+// one after another by the whole team, small ones concurrently, each by a single thread
+// in its own workspace.
+template<typename T, typename KeyOf = Identity>
+class BucketSorter {
+ public:
+  explicit BucketSorter(int threads, KeyOf key_of = KeyOf())
+	  : no_threads(threads), key_of(key_of), thread_workspaces(threads) {}
+
+  int threads() const { return no_threads; }
+
+  void sort(std::vector<T>& array, double min, double max, int no_buckets, PhaseTimes* times = nullptr) {
+	no_buckets = std::max(no_buckets, 1);
+	workspace.reserve(array.size(), no_buckets, no_threads);
+	if (times != nullptr) {
+	  times->threads.assign(no_threads, ThreadPhaseTimes());
+	}
+
+#pragma omp parallel num_threads(no_threads)
+	bucket_sort_team(array.data(), (int)array.size(), min, max, no_buckets, workspace, key_of, times);
+  }
+
+  // Every array gets one bucket per bucket_size elements.
+  void sort_batch(std::vector<std::vector<T>>& arrays, double min, double max, int bucket_size) {
+	auto buckets_of = [&](const std::vector<T>& array) {
+	  return std::max((int)array.size() / bucket_size, 1);
+	};
+
+	size_t max_size = 0;
+	int max_buckets = 1;
+	for (auto& array : arrays) {
+	  if (array.size() >= (size_t)team_sort_threshold) {
+		max_size = std::max(max_size, array.size());
+		max_buckets = std::max(max_buckets, buckets_of(array));
+	  }
+	}
+	workspace.reserve(max_size, max_buckets, no_threads);
+
+#pragma omp parallel num_threads(no_threads)
+	{
+	  for (auto& array : arrays) {
+		if (array.size() >= (size_t)team_sort_threshold) {
+		  bucket_sort_team(array.data(), (int)array.size(), min, max, buckets_of(array), workspace, key_of,
+						   (PhaseTimes*)nullptr);
+		}
+	  }
+
+	  BucketSortWorkspace<T>& my_workspace = thread_workspaces[omp_get_thread_num()];
+#pragma omp for schedule(dynamic)
+	  for (size_t i = 0; i < arrays.size(); i++) {
+		if (arrays[i].size() < (size_t)team_sort_threshold) {
+		  bucket_sort_sequential(arrays[i].data(), (int)arrays[i].size(), min, max, buckets_of(arrays[i]),
+								 my_workspace, key_of);
+		}
+	  }
+	}
+  }
+
+ private:
+  int no_threads;
+  KeyOf key_of;
+  BucketSortWorkspace<T> workspace;
+  std::vector<BucketSortWorkspace<T>> thread_workspaces;
+};
+
+// ------ Selection ----------
+
+// Values at the given ranks (0-based, keys in ascending order) without sorting the whole array.
+// Elements are counted per bucket as in bucket_sort_team, the prefix sum over counts tells
+// which buckets hold the requested ranks, only elements of those buckets are scattered
+// into a small buffer and only those buckets are ordered: with nth_element when a bucket
+// holds a single requested rank, sorted otherwise. Ranks must lie in [0, array.size()).
+template<typename T, typename KeyOf = Identity>
+std::vector<T> select_ranks(const std::vector<T>& array, const std::vector<int>& ranks, double min, double max,
+							int no_buckets, int threads, KeyOf key_of = KeyOf(), PhaseTimes* times = nullptr) {
+  int size = array.size();
+  no_buckets = std::max(no_buckets, 1);
+
+  std::vector<int> counts((size_t)threads * no_buckets);
+  std::vector<int> bucket_start(no_buckets + 1);
+  std::vector<int> prefix_sum_z(threads + 1);
+
+  // selected_start[bucket_index] is where a needed bucket starts in selected, -1 for the others.
+  std::vector<int> selected_start(no_buckets, -1);
+  std::vector<T> selected;
+
+  // needed buckets in ascending order, with the number of ranks they hold and one of them.
+  std::vector<int> needed, needed_no_ranks, needed_rank;
+  std::vector<int> rank_bucket(ranks.size());
+  std::vector<T> result(ranks.size());
+
+  if (times != nullptr) {
+	times->threads.assign(threads, ThreadPhaseTimes());
+  }
+
+#pragma omp parallel num_threads(threads)
+  {
+	int tid = omp_get_thread_num();
+	int* my_counts = &counts[(size_t)tid * no_buckets];
+	int indices[index_block_size];
+	int no_blocks = (size + index_block_size - 1) / index_block_size;
+
+	ThreadTime split_time = timed_phase([&] {
+#pragma omp for schedule(static)
+	  for (int block = 0; block < no_blocks; block++) {
+		int first = block * index_block_size;
+		int count = std::min(index_block_size, size - first);
+		compute_bucket_indices(&array[first], count, indices, no_buckets, min, max, key_of);
+		for (int j = 0; j < count; j++) {
+		  my_counts[indices[j]]++;
+		}
+	  }
+
+	  parallel_counts_prefix_sum(counts, prefix_sum_z, bucket_start, no_buckets);
+
+#pragma omp single
+	  {
+		bucket_start[no_buckets] = size;
+
+		// the last bucket starting at or before a rank is the non-empty one holding it.
+		std::vector<int> no_ranks(no_buckets);
+		for (size_t i = 0; i < ranks.size(); i++) {
+		  rank_bucket[i] = std::upper_bound(bucket_start.begin(), bucket_start.end(), ranks[i]) - bucket_start.begin() - 1;
+		  no_ranks[rank_bucket[i]]++;
+		}
+
+		int offset = 0;
+		for (size_t i = 0; i < ranks.size(); i++) {
+		  int bucket_index = rank_bucket[i];
+		  if (selected_start[bucket_index] < 0) {
+			selected_start[bucket_index] = 0;
+			needed.push_back(bucket_index);
+		  }
+		}
+		std::sort(needed.begin(), needed.end());
+		for (int bucket_index : needed) {
+		  selected_start[bucket_index] = offset;
+		  offset += bucket_start[bucket_index + 1] - bucket_start[bucket_index];
+		  needed_no_ranks.push_back(no_ranks[bucket_index]);
+		}
+		needed_rank.resize(needed.size());
+		for (size_t i = 0; i < ranks.size(); i++) {
+		  needed_rank[std::lower_bound(needed.begin(), needed.end(), rank_bucket[i]) - needed.begin()] = ranks[i];
+		}
+		selected.resize(offset);
+	  }
+
+	  // the same static chunks as the counting pass, only elements of needed buckets move.
+#pragma omp for schedule(static) nowait
+	  for (int block = 0; block < no_blocks; block++) {
+		int first = block * index_block_size;
+		int count = std::min(index_block_size, size - first);
+		compute_bucket_indices(&array[first], count, indices, no_buckets, min, max, key_of);
+		for (int j = 0; j < count; j++) {
+		  int bucket_index = indices[j];
+		  if (selected_start[bucket_index] >= 0) {
+			selected[selected_start[bucket_index] + my_counts[bucket_index]++ - bucket_start[bucket_index]] = array[first + j];
+		  }
+		}
+	  }
+	});
+
+	ThreadTime sort_time = timed_phase([&] {
+#pragma omp for schedule(dynamic) nowait
+	  for (size_t i = 0; i < needed.size(); i++) {
+		int bucket_index = needed[i];
+		T* first = &selected[selected_start[bucket_index]];
+		T* last = first + (bucket_start[bucket_index + 1] - bucket_start[bucket_index]);
+		if (needed_no_ranks[i] == 1) {
+		  std::nth_element(first, first + (needed_rank[i] - bucket_start[bucket_index]), last,
+						   [&](const T& a, const T& b) { return key_of(a) < key_of(b); });
+		} else {
+		  sort_bucket(first, last, key_of);
+		}
+	  }
+	});
+
+	ThreadTime write_time = timed_phase([&] {
+#pragma omp for schedule(static) nowait
+	  for (size_t i = 0; i < ranks.size(); i++) {
+		int bucket_index = rank_bucket[i];
+		result[i] = selected[selected_start[bucket_index] + ranks[i] - bucket_start[bucket_index]];
+	  }
+	});
+
+	if (times != nullptr) {
+	  record_thread_times(*times, split_time, sort_time, write_time);
+	}
+  }
+  return result;
+}
+
+// The k largest values, largest first.
+template<typename T, typename KeyOf = Identity>
+std::vector<T> top_k(const std::vector<T>& array, int k, double min, double max, int no_buckets, int threads,
+					 KeyOf key_of = KeyOf(), PhaseTimes* times = nullptr) {
+  std::vector<int> ranks;
+  for (int rank = (int)array.size() - 1; rank >= std::max((int)array.size() - k, 0); rank--) {
+	ranks.push_back(rank);
+  }
+  return select_ranks(array, ranks, min, max, no_buckets, threads, key_of, times);
+}
+
+// Values at quantiles in [0, 1], the nearest rank at or below q * (size - 1).
+template<typename T, typename KeyOf = Identity>
+std::vector<T> quantiles(const std::vector<T>& array, const std::vector<double>& qs, double min, double max,
+						 int no_buckets, int threads, KeyOf key_of = KeyOf(), PhaseTimes* times = nullptr) {
+  std::vector<int> ranks;
+  for (double q : qs) {
+	if (array.empty()) {
+	  break;
+	}
+	ranks.push_back((int)(std::min(std::max(q, 0.), 1.) * ((int)array.size() - 1)));
+  }
+  return select_ranks(array, ranks, min, max, no_buckets, threads, key_of, times);
+}
+
+// ------ Radix sort ----------
+
+const int radix_bits = 11;
+const int radix = 1 << radix_bits;
+
+// Stable LSD radix sort on the order-preserving bits of keys (KeyTraits),
+// does not depend on the range nor on the distribution of keys.
+// Every pass builds per-thread digit histograms of the thread's chunk,
+// computes write cursors with a prefix sum over (digit, thread)
+// and scatters elements into the other ping-pong buffer.
+// Passes in which all keys share a digit are skipped.
+// 4-byte keys take 3 passes, 8-byte keys 6.
+template<typename T, typename KeyOf = Identity>
+void radix_sort(std::vector<T>& array, int threads, KeyOf key_of = KeyOf(), PhaseTimes* times = nullptr) {
+  typedef typename KeyOfType<T, KeyOf>::type Key;
+  typedef KeyTraits<Key> Traits;
+  const int radix_passes = (8 * sizeof(typename Traits::Bits) + radix_bits - 1) / radix_bits;
+
+  int size = array.size();
+  std::unique_ptr<T[]> buffer(new T[size]);
+
+  std::vector<int> counts((size_t)threads * radix);
+  std::vector<int> digit_start(radix + 1);
+  std::vector<int> prefix_sum_z(threads + 1);
+  if (times != nullptr) {
+	times->threads.assign(threads, ThreadPhaseTimes());
+  }
+
+#pragma omp parallel shared(buffer, counts, digit_start, prefix_sum_z) num_threads(threads)
+  {
+	int tid = omp_get_thread_num();
+	int* my_counts = &counts[(size_t)tid * radix];
+	T* source = array.data();
+	T* destination = buffer.get();
+
+	auto digit_of = [&](const T& value, int shift) {
+	  return (int)((Traits::to_bits(key_of(value)) >> shift) & (radix - 1));
+	};
+
+	// counting digits maps to splitting, scattering to sorting.
+	ThreadTime split_time, sort_time;
+
+	for (int pass = 0; pass < radix_passes; pass++) {
+	  int shift = pass * radix_bits;
+	  bool trivial_pass = false;
+
+	  split_time += timed_phase([&] {
+		std::fill(my_counts, my_counts + radix, 0);
+#pragma omp for schedule(static) nowait
+		for (int i = 0; i < size; i++) {
+		  my_counts[digit_of(source[i], shift)]++;
+		}
+	  });
+
+	  split_time.work += timed([&] {
+		parallel_counts_prefix_sum(counts, prefix_sum_z, digit_start, radix);
+
+		// every thread sees the same counts, so all of them agree on skipping.
+		if (size > 0) {
+		  int first_digit = digit_of(source[0], shift);
+		  int next_start = first_digit + 1 < radix ? digit_start[first_digit + 1] : size;
+		  trivial_pass = next_start - digit_start[first_digit] == size;
+		}
+	  });
+
+	  if (trivial_pass) {
+#pragma omp barrier
+		continue;
+	  }
+
+	  // static schedule hands every thread the same chunk as in the counting pass.
+	  sort_time += timed_phase([&] {
+#pragma omp for schedule(static) nowait
+		for (int i = 0; i < size; i++) {
+		  destination[my_counts[digit_of(source[i], shift)]++] = source[i];
+		}
+	  });
+
+	  std::swap(source, destination);
+	}
+
+	// after an odd number of passes the result sits in the buffer.
+	ThreadTime write_time = timed_phase([&] {
+	  if (source != array.data()) {
+#pragma omp for schedule(static) nowait
+		for (int i = 0; i < size; i++) {
+		  array[i] = source[i];
+		}
+	  }
+	});
+
+	if (times != nullptr) {
+	  record_thread_times(*times, split_time, sort_time, write_time);
+	}
+  }
+}
+
+// ------ Argsort ----------
+
+// Permutation which sorts values by key (stable), i.e. values[permutation[0]] holds the smallest key.
+// (key bits, index) pairs are radix sorted, so values are read only once.
+// A 4-byte Index halves the memory traffic when there are fewer than 2^32 values.
+template<typename Index = uint32_t, typename T, typename KeyOf = Identity>
+std::vector<Index> argsort(const std::vector<T>& values, int threads, KeyOf key_of = KeyOf(),
+						   PhaseTimes* times = nullptr) {
+  typedef typename KeyOfType<T, KeyOf>::type Key;
+  typedef typename KeyTraits<Key>::Bits Bits;
+
+  struct Entry {
+	Bits key;
+	Index index;
+  };
+
+  int size = values.size();
+  std::vector<Entry> entries(size);
+#pragma omp parallel for schedule(static) num_threads(threads)
+  for (int i = 0; i < size; i++) {
+	entries[i].key = KeyTraits<Key>::to_bits(key_of(values[i]));
+	entries[i].index = i;
+  }
+
+  radix_sort(entries, threads, [](const Entry& entry) { return entry.key; }, times);
+
+  std::vector<Index> permutation(size);
+#pragma omp parallel for schedule(static) num_threads(threads)
+  for (int i = 0; i < size; i++) {
+	permutation[i] = entries[i].index;
+  }
+  return permutation;
+}
+
+// ------ Counter-based random numbers ----------
+
+// Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3").
+// Every 128-bit counter maps to 4 random words under a key (the seed),
+// so element i of the generated array depends only on the seed and i,
+// not on the number of threads nor on SCHEDULE.
+
+const uint32_t philox_m0 = 0xD2511F53, philox_m1 = 0xCD9E8D57;
+const uint32_t philox_w0 = 0x9E3779B9, philox_w1 = 0xBB67AE85;
+const int philox_rounds = 10;
+
+// independent streams drawn from the same seed.
+const uint32_t uniform_stream = 0, distribution_stream = 1;
+
+inline void philox4x32(uint32_t counter[4], uint64_t seed) {
+  uint32_t k0 = (uint32_t)seed, k1 = (uint32_t)(seed >> 32);
+  for (int round = 0; round < philox_rounds; round++) {
+	uint64_t product0 = (uint64_t)philox_m0 * counter[0];
+	uint64_t product1 = (uint64_t)philox_m1 * counter[2];
+	uint32_t x1 = counter[1], x3 = counter[3];
+	counter[0] = (uint32_t)(product1 >> 32) ^ x1 ^ k0;
+	counter[1] = (uint32_t)product1;
+	counter[2] = (uint32_t)(product0 >> 32) ^ x3 ^ k1;
+	counter[3] = (uint32_t)product0;
+	k0 += philox_w0;
+	k1 += philox_w1;
+  }
+}
+
+const uint64_t exponent_of_one = 0x3FF0000000000000ull;
+
+// 52 random bits as the mantissa of a double in [1, 2), minus one -> [0, 1)
+inline double words_to_unit(uint32_t high, uint32_t low) {
+  uint64_t bits = ((((uint64_t)high << 32) | low) >> 12) | exponent_of_one;
+  double value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value - 1.;
+}
+
+// Every block (counter) yields two doubles: element i comes from block i / 2.
+inline void philox_uniform_block(uint64_t block, uint64_t seed, double min, double max, double* values) {
+  uint32_t counter[4] = {(uint32_t)block, (uint32_t)(block >> 32), uniform_stream, 0};
+  philox4x32(counter, seed);
+  values[0] = min + (max - min) * words_to_unit(counter[0], counter[1]);
+  values[1] = min + (max - min) * words_to_unit(counter[2], counter[3]);
+}
+
+#if defined(__x86_64__)
+
+// Four blocks at a time, each 32-bit word kept in the low half of a 64-bit lane
+// so _mm256_mul_epu32 gives the full 64-bit products. Bit-identical to the scalar version.
+__attribute__((target("avx2")))
+inline size_t philox_uniform_fill_avx2(double* values, uint64_t first_block, size_t no_blocks,
+									   uint64_t seed, double min, double max) {
+  const __m256i low_mask = _mm256_set1_epi64x(0xFFFFFFFF);
+  const __m256i m0 = _mm256_set1_epi64x(philox_m0), m1 = _mm256_set1_epi64x(philox_m1);
+  const __m256i exponent = _mm256_set1_epi64x(exponent_of_one);
+  const __m256d one = _mm256_set1_pd(1.);
+  const __m256d low = _mm256_set1_pd(min), width = _mm256_set1_pd(max - min);
+
+  size_t b = 0;
+  for (; b + 4 <= no_blocks; b += 4) {
+	uint64_t block = first_block + b;
+	__m256i blocks = _mm256_add_epi64(_mm256_set1_epi64x(block), _mm256_set_epi64x(3, 2, 1, 0));
+	__m256i x0 = _mm256_and_si256(blocks, low_mask);
+	__m256i x1 = _mm256_srli_epi64(blocks, 32);
+	__m256i x2 = _mm256_set1_epi64x(uniform_stream);
+	__m256i x3 = _mm256_setzero_si256();
+
+	uint32_t k0 = (uint32_t)seed, k1 = (uint32_t)(seed >> 32);
+	for (int round = 0; round < philox_rounds; round++) {
+	  __m256i product0 = _mm256_mul_epu32(m0, x0);
+	  __m256i product1 = _mm256_mul_epu32(m1, x2);
+	  __m256i y0 = _mm256_xor_si256(_mm256_xor_si256(_mm256_srli_epi64(product1, 32), x1), _mm256_set1_epi64x(k0));
+	  __m256i y2 = _mm256_xor_si256(_mm256_xor_si256(_mm256_srli_epi64(product0, 32), x3), _mm256_set1_epi64x(k1));
+	  x1 = _mm256_and_si256(product1, low_mask);
+	  x3 = _mm256_and_si256(product0, low_mask);
+	  x0 = y0;
+	  x2 = y2;
+	  k0 += philox_w0;
+	  k1 += philox_w1;
+	}
+
+	// same as words_to_unit: mantissa of a double in [1, 2), minus one.
+	__m256i bits0 = _mm256_srli_epi64(_mm256_or_si256(_mm256_slli_epi64(x0, 32), x1), 12);
+	__m256i bits1 = _mm256_srli_epi64(_mm256_or_si256(_mm256_slli_epi64(x2, 32), x3), 12);
+	__m256d unit0 = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(bits0, exponent)), one);
+	__m256d unit1 = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(bits1, exponent)), one);
+	__m256d values0 = _mm256_add_pd(low, _mm256_mul_pd(width, unit0));
+	__m256d values1 = _mm256_add_pd(low, _mm256_mul_pd(width, unit1));
+
+	// interleave so that both values of a block are adjacent.
+	__m256d even = _mm256_unpacklo_pd(values0, values1);
+	__m256d odd = _mm256_unpackhi_pd(values0, values1);
+	_mm256_storeu_pd(&values[2 * b], _mm256_permute2f128_pd(even, odd, 0x20));
+	_mm256_storeu_pd(&values[2 * b + 4], _mm256_permute2f128_pd(even, odd, 0x31));
+  }
+  return b;
+}
+
+#endif
+
+// Bulk fill of values[0, count) with elements first .. first + count of the seed's sequence.
+inline void philox_uniform_fill(double* values, size_t first, size_t count, uint64_t seed, double min, double max) {
+  double block_values[2];
+  size_t i = 0;
+
+  // an odd first element takes the second half of its block.
+  if (count > 0 && first % 2 == 1) {
+	philox_uniform_block(first / 2, seed, min, max, block_values);
+	values[i++] = block_values[1];
+  }
+
+  uint64_t first_block = (first + i) / 2;
+  size_t no_blocks = (count - i) / 2, b = 0;
+#if defined(__x86_64__)
+  if (cpu_has_avx2()) {
+	b = philox_uniform_fill_avx2(&values[i], first_block, no_blocks, seed, min, max);
+  }
+#endif
+  for (; b < no_blocks; b++) {
+	philox_uniform_block(first_block + b, seed, min, max, &values[i + 2 * b]);
+  }
+  i += 2 * no_blocks;
+
+  if (i < count) {
+	philox_uniform_block((first + i) / 2, seed, min, max, block_values);
+	values[i] = block_values[0];
+  }
+}
+
+// ------ Multiset fingerprint ----------
+
+// Order-independent fingerprint of a multiset of values:
+// two sums (mod 2^64) of differently mixed bit patterns.
+// Sums of fingerprints (of the ranks' slices, say) fingerprint the union.
+struct Fingerprint {
+  uint64_t sum_1 = 0;
+  uint64_t sum_2 = 0;
+
+  bool operator==(const Fingerprint& other) const {
+	return sum_1 == other.sum_1 && sum_2 == other.sum_2;
+  }
+};
+
+// splitmix64 finalizer.
+inline uint64_t mix(uint64_t x) {
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+  return x ^ (x >> 31);
+}
+
+template<typename T>
+Fingerprint fingerprint(const T* values, size_t size, int threads) {
+  uint64_t sum_1 = 0, sum_2 = 0;
+#pragma omp parallel for schedule(static) reduction(+:sum_1, sum_2) num_threads(threads)
+  for (size_t i = 0; i < size; i++) {
+	uint64_t bits = 0;
+	std::memcpy(&bits, &values[i], sizeof(T));
+	sum_1 += mix(bits);
+	sum_2 += mix(bits ^ 0x9E3779B97F4A7C15ull);
+  }
+
+  Fingerprint result;
+  result.sum_1 = sum_1;
+  result.sum_2 = sum_2;
+  return result;
+}
+
+} // namespace parallel_sort
+
+#endif // PARALLEL_SORT_H
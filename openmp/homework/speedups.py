@@ -0,0 +1,34 @@
+import pandas as pd
+import sys
+
+# Speedups of every algorithm over the best library baseline (#8 std::sort,
+# #9 __gnu_parallel::sort, #10 std::execution::par_unseq), per size and thread count.
+# Reads the output of ./build/measure --sweep=<file> --sweep-versions=...,8-10;
+# for every algorithm the best median overall time over the other sweep dimensions is taken.
+# The baseline is the best of those present, a C++11 build skips #10.
+#
+# usage: python3 speedups.py sweep.csv [speedups.csv]
+
+baselines = [8, 9, 10]
+
+
+def main(sweep_file, output_file=None):
+    df = pd.read_csv(sweep_file, sep=';')
+    overall = df[df['phase'] == 'overall']
+    best = overall.groupby(['size', 'threads', 'algorithm'])['median'].min().unstack('algorithm')
+
+    available = [version for version in baselines if version in best.columns]
+    if not available:
+        sys.exit('no library baseline (versions 8-10) in ' + sweep_file)
+
+    baseline = best[available].min(axis=1)
+    speedups = best.rdiv(baseline, axis=0)
+    speedups.insert(0, 'baseline', best[available].idxmin(axis=1))
+
+    print(speedups.to_string(float_format='%.2f'))
+    if output_file:
+        speedups.to_csv(output_file, sep=';')
+
+
+if __name__ == "__main__":
+    main(*sys.argv[1:3])
@@ -0,0 +1,14 @@
+#!/bin/bash 
+export VNODE_CLUSTER_SINGLE_NODE=true
+make strong-scaling
+make weak-scaling
+
+export VNODE_CLUSTER_SINGLE_NODE=false
+export VNODE_CLUSTER_TWO_NODES=true
+make strong-scaling
+make weak-scaling
+
+export VNODE_CLUSTER_TWO_NODES=false
+export VNODE_CLUSTER_ALL_NODES=true
+make strong-scaling MAX_RANKS=12
+make weak-scaling MAX_RANKS=12
@@ -0,0 +1,290 @@
+#include <mpi.h>
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <algorithm>
+#include <vector>
+#include "parallel_sort.h"
+
+/*
+    Hybrid MPI + OpenMP bucket sort of doubles uniform in [0, 1).
+
+    Every rank owns the range of values [rank / ranks, (rank + 1) / ranks):
+        1. each rank generates its slice of the data,
+        2. splits it by destination rank with count-then-scatter (OpenMP),
+        3. ranges are exchanged with MPI_Alltoallv,
+        4. each rank bucket sorts the range it received (OpenMP).
+    Concatenating the ranks' arrays in rank order gives the sorted data.
+
+    Usage: distributed_sort <size> [threads per rank] [strong|weak] [input file]
+        strong - size is the total number of elements (default),
+        weak   - size is the number of elements per rank,
+        input file - raw doubles (as written by measure --generate-file), each rank
+                     reads its slice of the first total size elements instead of generating it.
+*/
+
+#define BUCKET_SIZE 50
+#define SEED 17
+// elements per MPI_File_read_at_all, the count is an int.
+#define READ_CHUNK_SIZE (1 << 24)
+
+struct Times {
+  double generate;
+  double split;
+  double exchange;
+  double sort;
+  double overall;
+};
+
+// Element i of the slice is element first + i of the whole data set (Philox,
+// keyed by the global index), so the data does not depend on ranks nor threads.
+void generate_slice(std::vector<double>& slice, long long int first, int threads) {
+#pragma omp parallel num_threads(threads)
+  {
+    int thread = omp_get_thread_num(), no_threads = omp_get_num_threads();
+    size_t begin = slice.size() * thread / no_threads, end = slice.size() * (thread + 1) / no_threads;
+    parallel_sort::philox_uniform_fill(slice.data() + begin, first + begin, end - begin, SEED, 0., 1.);
+  }
+}
+
+// Collective: every rank reads elements [first, first + slice.size()) of the file.
+void read_slice(std::vector<double>& slice, long long int first, const char* path) {
+  MPI_File file;
+  MPI_File_open(MPI_COMM_WORLD, path, MPI_MODE_RDONLY, MPI_INFO_NULL, &file);
+
+  // every rank takes part in the same number of collective reads.
+  long long int local_chunks = (slice.size() + READ_CHUNK_SIZE - 1) / READ_CHUNK_SIZE, chunks;
+  MPI_Allreduce(&local_chunks, &chunks, 1, MPI_LONG_LONG_INT, MPI_MAX, MPI_COMM_WORLD);
+  for (long long int chunk = 0; chunk < chunks; chunk++) {
+    size_t begin = std::min(slice.size(), (size_t)(chunk * READ_CHUNK_SIZE));
+    int count = std::min(slice.size() - begin, (size_t)READ_CHUNK_SIZE);
+    MPI_File_read_at_all(file, (first + begin) * sizeof(double), slice.data() + begin, count, MPI_DOUBLE,
+                         MPI_STATUS_IGNORE);
+  }
+  MPI_File_close(&file);
+}
+
+// Elements in the file, -1 when it cannot be opened.
+long long int file_size(const char* path) {
+  MPI_File file;
+  if (MPI_File_open(MPI_COMM_WORLD, path, MPI_MODE_RDONLY, MPI_INFO_NULL, &file) != MPI_SUCCESS) {
+    return -1;
+  }
+  MPI_Offset bytes;
+  MPI_File_get_size(file, &bytes);
+  MPI_File_close(&file);
+  return bytes / sizeof(double);
+}
+
+int destination_rank(double value, int ranks) {
+  return parallel_sort::bucket_index(value, ranks, 0., 1.);
+}
+
+// Count-then-scatter by destination rank: send_buffer holds the ranges
+// for consecutive ranks back to back, send_counts their sizes.
+// Counts are ints, as MPI takes them, which the caller has checked (see fits_in_int).
+void split_by_rank(const std::vector<double>& slice, std::vector<double>& send_buffer,
+                   std::vector<int>& send_counts, int ranks, int threads) {
+  size_t size = slice.size();
+  std::vector<int> counts((size_t)threads * ranks);
+  std::vector<int> rank_start(ranks + 1);
+  std::vector<int> prefix_sum_z(threads + 1);
+
+#pragma omp parallel num_threads(threads)
+  {
+    int* my_counts = &counts[(size_t)omp_get_thread_num() * ranks];
+
+#pragma omp for schedule(static)
+    for (size_t i = 0; i < size; i++) {
+      my_counts[destination_rank(slice[i], ranks)]++;
+    }
+
+    parallel_sort::parallel_counts_prefix_sum(counts, prefix_sum_z, rank_start, ranks);
+
+#pragma omp single
+    rank_start[ranks] = size;
+
+#pragma omp for schedule(static)
+    for (size_t i = 0; i < size; i++) {
+      send_buffer[my_counts[destination_rank(slice[i], ranks)]++] = slice[i];
+    }
+  }
+
+  for (int r = 0; r < ranks; r++) {
+    send_counts[r] = rank_start[r + 1] - rank_start[r];
+  }
+}
+
+// Collective: true when value fits into an int (MPI counts and displacements) on every rank,
+// otherwise rank 0 reports what does not.
+bool fits_in_int(long long int value, const char* what, int rank) {
+  long long int max_value;
+  MPI_Allreduce(&value, &max_value, 1, MPI_LONG_LONG_INT, MPI_MAX, MPI_COMM_WORLD);
+  if (max_value > INT_MAX) {
+    if (rank == 0) {
+      fprintf(stderr, "%s of %lld elements on a rank, at most %d supported\n", what, max_value, INT_MAX);
+    }
+    return false;
+  }
+  return true;
+}
+
+std::vector<int> displacements(const std::vector<int>& counts) {
+  std::vector<int> result(counts.size());
+  for (size_t r = 1; r < counts.size(); r++) {
+    result[r] = result[r - 1] + counts[r - 1];
+  }
+  return result;
+}
+
+// Collective: fingerprint of the data on all ranks together.
+parallel_sort::Fingerprint global_fingerprint(const std::vector<double>& data, int threads) {
+  parallel_sort::Fingerprint local = parallel_sort::fingerprint(data.data(), data.size(), threads);
+  uint64_t local_sums[2] = {local.sum_1, local.sum_2}, sums[2];
+  MPI_Allreduce(local_sums, sums, 2, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+
+  parallel_sort::Fingerprint result;
+  result.sum_1 = sums[0];
+  result.sum_2 = sums[1];
+  return result;
+}
+
+// Locally sorted, ordered against the previous rank, nothing lost
+// and a permutation of the input (the same fingerprint).
+bool verify(const std::vector<double>& sorted, long long int total_size,
+            const parallel_sort::Fingerprint& input_fingerprint, int rank, int ranks, int threads) {
+  int locally_sorted = 1;
+  for (size_t i = 1; i < sorted.size(); i++) {
+    if (sorted[i - 1] > sorted[i]) {
+      locally_sorted = 0;
+    }
+  }
+
+  // empty ranks pass on the last value of their predecessor.
+  double last = -1., previous_last = -1.;
+  if (rank > 0) {
+    MPI_Recv(&previous_last, 1, MPI_DOUBLE, rank - 1, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+  }
+  last = sorted.empty() ? previous_last : sorted.back();
+  if (rank + 1 < ranks) {
+    MPI_Send(&last, 1, MPI_DOUBLE, rank + 1, 0, MPI_COMM_WORLD);
+  }
+  if (!sorted.empty() && sorted.front() < previous_last) {
+    locally_sorted = 0;
+  }
+
+  int all_sorted;
+  long long int local_size = sorted.size(), sorted_size;
+  MPI_Allreduce(&locally_sorted, &all_sorted, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+  MPI_Allreduce(&local_size, &sorted_size, 1, MPI_LONG_LONG_INT, MPI_SUM, MPI_COMM_WORLD);
+  bool permutation = global_fingerprint(sorted, threads) == input_fingerprint;
+  return all_sorted && sorted_size == total_size && permutation;
+}
+
+int main(int argc, char* argv[]) {
+  int provided;
+  MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+
+  int rank, ranks;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+
+  if (argc < 2) {
+    if (rank == 0) {
+      fprintf(stderr, "Usage: %s <size> [threads per rank] [strong|weak] [input file]\n", argv[0]);
+    }
+    MPI_Finalize();
+    return 1;
+  }
+
+  long long int size = strtoll(argv[1], NULL, 10);
+  int threads = argc > 2 ? atoi(argv[2]) : 1;
+  bool weak_scaling = argc > 3 && strcmp(argv[3], "weak") == 0;
+  const char* input_file = argc > 4 ? argv[4] : NULL;
+
+  long long int total_size = weak_scaling ? size * ranks : size;
+  if (input_file != NULL) {
+    long long int input_size = file_size(input_file);
+    if (input_size < total_size) {
+      if (rank == 0) {
+        fprintf(stderr, "%s holds %lld elements, %lld needed\n", input_file, input_size, total_size);
+      }
+      MPI_Finalize();
+      return 1;
+    }
+  }
+  long long int local_size = total_size / ranks + (rank < total_size % ranks);
+  long long int first = rank * (total_size / ranks) + std::min<long long int>(rank, total_size % ranks);
+  if (!fits_in_int(local_size, "A slice", rank)) {
+    MPI_Finalize();
+    return 1;
+  }
+
+  Times times;
+  std::vector<double> slice(local_size);
+  times.generate = MPI_Wtime();
+  if (input_file != NULL) {
+    read_slice(slice, first, input_file);
+  } else {
+    generate_slice(slice, first, threads);
+  }
+  times.generate = MPI_Wtime() - times.generate;
+  parallel_sort::Fingerprint input_fingerprint = global_fingerprint(slice, threads);
+
+  MPI_Barrier(MPI_COMM_WORLD);
+  double start_time = MPI_Wtime();
+
+  // 1. split by destination rank.
+  std::vector<double> send_buffer(local_size);
+  std::vector<int> send_counts(ranks), receive_counts(ranks);
+  times.split = MPI_Wtime();
+  split_by_rank(slice, send_buffer, send_counts, ranks, threads);
+  times.split = MPI_Wtime() - times.split;
+
+  // 2. exchange ranges.
+  times.exchange = MPI_Wtime();
+  MPI_Alltoall(send_counts.data(), 1, MPI_INT, receive_counts.data(), 1, MPI_INT, MPI_COMM_WORLD);
+  long long int received_size = 0;
+  for (int count : receive_counts) {
+    received_size += count;
+  }
+  if (!fits_in_int(received_size, "A received range", rank)) {
+    MPI_Finalize();
+    return 1;
+  }
+  std::vector<int> send_displacements = displacements(send_counts);
+  std::vector<int> receive_displacements = displacements(receive_counts);
+  std::vector<double> received(received_size);
+  MPI_Alltoallv(send_buffer.data(), send_counts.data(), send_displacements.data(), MPI_DOUBLE,
+                received.data(), receive_counts.data(), receive_displacements.data(), MPI_DOUBLE,
+                MPI_COMM_WORLD);
+  times.exchange = MPI_Wtime() - times.exchange;
+
+  // 3. sort the owned range.
+  times.sort = MPI_Wtime();
+  double range_min = (double)rank / ranks, range_max = (double)(rank + 1) / ranks;
+  parallel_sort::bucket_sort(received, range_min, range_max, received.size() / BUCKET_SIZE, threads);
+  times.sort = MPI_Wtime() - times.sort;
+
+  times.overall = MPI_Wtime() - start_time;
+
+  // the slowest rank determines every phase.
+  Times max_times;
+  MPI_Reduce(&times, &max_times, 5, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+
+  bool sorted = verify(received, total_size, input_fingerprint, rank, ranks, threads);
+
+  if (rank == 0) {
+    if (!sorted) {
+      fprintf(stderr, "Verification failed\n");
+    }
+    printf("%d,%d,%s,%lld,%f,%f,%f,%f,%f\n", ranks, threads, weak_scaling ? "weak" : "strong",
+           total_size, max_times.generate, max_times.split, max_times.exchange, max_times.sort,
+           max_times.overall);
+  }
+
+  MPI_Finalize();
+  return 0;
+}
@@ -0,0 +1,298 @@
+#include <mpi.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef DEBUG
+#define DEBUG_PRINTF(...) printf(__VA_ARGS__)
+#else
+#define DEBUG_PRINTF(...)                                                      \
+  do {                                                                         \
+  } while (0)
+#endif
+
+#define INFO_PRINTF(...)                                                       \
+  do {                                                                         \
+    printf("INFO: "__VA_ARGS__);                                               \
+    puts("");                                                                  \
+  } while (0)
+
+// Message-size sweep in a single MPI session: for every size of the schedule
+// a few warm-up rounds, then ping-pong rounds timed one by one on rank 0.
+// Latency is half of a round trip, bandwidth the message size over it.
+//
+// args,
+// - schedule: steps (the three tiers of the makefile's ssend-run),
+//   linear:MIN:MAX:STEP or log:MIN:MAX:FACTOR, sizes in bytes
+// - communication: send, ssend or ibsend
+// - rounds: timed rounds per size, at most
+// - warmup_rounds: untimed rounds per size
+// - bytes_per_size: caps the rounds of large messages to about that much data,
+//   at least MIN_TIMED_ROUNDS are timed
+// - output_file with measurements, optional.
+
+#define PING_TAG 0
+#define PONG_TAG 1
+#define MIN_TIMED_ROUNDS 10
+#define MAX_SCHEDULE_SIZE 100000
+
+// steps schedule, as in the makefile.
+#define VERY_SMALL_STEP_SIZE_BYTES 100
+#define VERY_SMALL_STEP_THRESHOLD_BYTES 5000
+#define SMALL_STEP_SIZE_BYTES 1000
+#define SMALL_STEP_THRESHOLD_BYTES 250000
+#define STEP_SIZE_BYTES 100000
+#define MAX_MESSAGE_SIZE 10000000
+
+typedef enum { SEND, SSEND, IBSEND } communication_t;
+
+char* allocate_n_bytes(int n_bytes) { return malloc(sizeof(char) * n_bytes); }
+
+int append_linear(int* sizes, int count, int min, int max, int step) {
+  for (long int size = min; size <= max && count < MAX_SCHEDULE_SIZE;
+       size += step) {
+    sizes[count++] = size;
+  }
+  return count;
+}
+
+// Message sizes of the schedule, their count or -1 when it is invalid.
+int parse_schedule(const char* schedule, int* sizes) {
+  int min, max;
+  if (strcmp(schedule, "steps") == 0) {
+    int count = append_linear(sizes, 0, 1, VERY_SMALL_STEP_THRESHOLD_BYTES,
+                              VERY_SMALL_STEP_SIZE_BYTES);
+    count = append_linear(sizes, count, VERY_SMALL_STEP_THRESHOLD_BYTES,
+                          SMALL_STEP_THRESHOLD_BYTES, SMALL_STEP_SIZE_BYTES);
+    return append_linear(sizes, count, STEP_SIZE_BYTES, MAX_MESSAGE_SIZE,
+                         STEP_SIZE_BYTES);
+  }
+
+  int step;
+  if (sscanf(schedule, "linear:%d:%d:%d", &min, &max, &step) == 3) {
+    if (min < 1 || max < min || step < 1) {
+      return -1;
+    }
+    return append_linear(sizes, 0, min, max, step);
+  }
+
+  double factor;
+  if (sscanf(schedule, "log:%d:%d:%lf", &min, &max, &factor) == 3) {
+    if (min < 1 || max < min || factor <= 1.) {
+      return -1;
+    }
+    int count = 0;
+    for (double size = min; size <= max && count < MAX_SCHEDULE_SIZE;
+         size *= factor) {
+      // small sizes repeat once truncated.
+      if (count == 0 || (int)size > sizes[count - 1]) {
+        sizes[count++] = (int)size;
+      }
+    }
+    return count;
+  }
+  return -1;
+}
+
+bool parse_communication(const char* name, communication_t* communication) {
+  if (strcmp(name, "send") == 0) {
+    *communication = SEND;
+  } else if (strcmp(name, "ssend") == 0) {
+    *communication = SSEND;
+  } else if (strcmp(name, "ibsend") == 0) {
+    *communication = IBSEND;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+long int compute_rounds_count(long int n_bytes_to_transfer, int message_size,
+                              long int max_rounds) {
+  long int rounds = n_bytes_to_transfer / (2 * (long int)message_size);
+  if (rounds < MIN_TIMED_ROUNDS) {
+    rounds = MIN_TIMED_ROUNDS;
+  }
+  return rounds < max_rounds ? rounds : max_rounds;
+}
+
+// The attached buffer holds one message, the ibsend of the previous round has
+// been received by the time the next one starts.
+void send_message(communication_t communication, char* message,
+                  int message_size, int partner_rank, int tag) {
+  if (communication == SEND) {
+    MPI_Send(message, message_size, MPI_CHAR, partner_rank, tag,
+             MPI_COMM_WORLD);
+  } else if (communication == SSEND) {
+    MPI_Ssend(message, message_size, MPI_CHAR, partner_rank, tag,
+              MPI_COMM_WORLD);
+  } else {
+    MPI_Request request;
+    MPI_Ibsend(message, message_size, MPI_CHAR, partner_rank, tag,
+               MPI_COMM_WORLD, &request);
+    MPI_Wait(&request, MPI_STATUS_IGNORE);
+  }
+}
+
+// One ping-pong round, its round-trip time on rank 0.
+double ping_pong_round(communication_t communication, int world_rank,
+                       char* send_buffer, char* receive_buffer,
+                       int message_size) {
+  int partner_rank = (world_rank + 1) % 2;
+  if (world_rank == 0) {
+    send_buffer[0] = (char)rand();
+    double start_wtime = MPI_Wtime();
+    send_message(communication, send_buffer, message_size, partner_rank,
+                 PING_TAG);
+    MPI_Recv(receive_buffer, message_size, MPI_CHAR, partner_rank, PONG_TAG,
+             MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    return MPI_Wtime() - start_wtime;
+  }
+
+  MPI_Recv(receive_buffer, message_size, MPI_CHAR, partner_rank, PING_TAG,
+           MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+  send_buffer[0] = receive_buffer[0];
+  send_message(communication, send_buffer, message_size, partner_rank,
+               PONG_TAG);
+  return 0.;
+}
+
+int compare_doubles(const void* a, const void* b) {
+  double x = *(const double*)a, y = *(const double*)b;
+  return (x > y) - (x < y);
+}
+
+// value below which `percent` percent of the sorted values lie.
+double percentile(const double* sorted, long int count, int percent) {
+  long int index = (count * percent + 99) / 100 - 1;
+  return sorted[index < 0 ? 0 : index];
+}
+
+double compute_throughput_mbit_s(int message_size, double latency) {
+  return ((message_size * 8.) / 1e6) / latency;
+}
+
+int main(int argc, char* argv[]) {
+  // mpi related
+  MPI_Init(&argc, &argv);
+  int world_rank;
+  MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
+  int world_size;
+  MPI_Comm_size(MPI_COMM_WORLD, &world_size);
+
+  int* sizes = malloc(sizeof(int) * MAX_SCHEDULE_SIZE);
+  communication_t communication;
+  int sizes_count = argc > 5 ? parse_schedule(argv[1], sizes) : -1;
+  if (world_size != 2 || sizes_count <= 0 ||
+      !parse_communication(argv[2], &communication)) {
+    if (world_rank == 0) {
+      INFO_PRINTF("usage: mpiexec -n 2 sweep <steps|linear:MIN:MAX:STEP|"
+                  "log:MIN:MAX:FACTOR> <send|ssend|ibsend> <rounds> "
+                  "<warmup_rounds> <bytes_per_size> [output_file]");
+    }
+    MPI_Finalize();
+    return 1;
+  }
+  long int max_rounds = strtol(argv[3], NULL, 10);
+  long int warmup_rounds = strtol(argv[4], NULL, 10);
+  long int bytes_per_size = strtol(argv[5], NULL, 10);
+  if (max_rounds < 1) {
+    max_rounds = 1;
+  }
+
+  FILE* datafile_fp = NULL;
+  if (argc > 6 && world_rank == 0) {
+    datafile_fp = fopen(argv[6], "w");
+  }
+
+  int max_message_size = 0;
+  for (int i = 0; i < sizes_count; i++) {
+    if (sizes[i] > max_message_size) {
+      max_message_size = sizes[i];
+    }
+  }
+
+  // buffers are allocated once and touched before the first round.
+  char* send_buffer = allocate_n_bytes(max_message_size);
+  char* receive_buffer = allocate_n_bytes(max_message_size);
+  memset(send_buffer, 0, max_message_size);
+  memset(receive_buffer, 0, max_message_size);
+  double* round_times = malloc(sizeof(double) * max_rounds);
+
+  int buffer_attached_size = 0;
+  char* buffer_attached = NULL;
+  if (communication == IBSEND) {
+    buffer_attached_size = max_message_size + MPI_BSEND_OVERHEAD;
+    buffer_attached = allocate_n_bytes(buffer_attached_size);
+    MPI_Buffer_attach(buffer_attached, buffer_attached_size);
+  }
+
+  const char* header = "# message_size[B] rounds latency_min[us] "
+                       "latency_median[us] latency_p99[us] "
+                       "bandwidth_max[Mbit/s] bandwidth_median[Mbit/s] "
+                       "bandwidth_p99[Mbit/s]";
+  if (world_rank == 0) {
+    INFO_PRINTF("Sizes: %d, communication: %s, rounds: %ld, warm-up: %ld",
+                sizes_count, argv[2], max_rounds, warmup_rounds);
+    printf("%s\n", header);
+    if (datafile_fp != NULL) {
+      fprintf(datafile_fp, "%s\n", header);
+    }
+  }
+
+  double start_wtime = MPI_Wtime();
+  for (int i = 0; i < sizes_count; i++) {
+    int message_size = sizes[i];
+    long int rounds =
+        compute_rounds_count(bytes_per_size, message_size, max_rounds);
+
+    // synchronization
+    MPI_Barrier(MPI_COMM_WORLD);
+    for (long int round_id = 0; round_id < warmup_rounds; round_id++) {
+      ping_pong_round(communication, world_rank, send_buffer, receive_buffer,
+                      message_size);
+    }
+    for (long int round_id = 0; round_id < rounds; round_id++) {
+      round_times[round_id] =
+          ping_pong_round(communication, world_rank, send_buffer,
+                          receive_buffer, message_size) /
+          2;
+      DEBUG_PRINTF("Size: %d, round: %ld, latency: %.9fs\n", message_size,
+                   round_id, round_times[round_id]);
+    }
+
+    if (world_rank == 0) {
+      qsort(round_times, rounds, sizeof(double), compare_doubles);
+      double latency_min = round_times[0];
+      double latency_median = percentile(round_times, rounds, 50);
+      double latency_p99 = percentile(round_times, rounds, 99);
+
+      char row[256];
+      snprintf(row, sizeof(row), "%d %ld %.3f %.3f %.3f %.6f %.6f %.6f",
+               message_size, rounds, latency_min * 1e6, latency_median * 1e6,
+               latency_p99 * 1e6,
+               compute_throughput_mbit_s(message_size, latency_min),
+               compute_throughput_mbit_s(message_size, latency_median),
+               compute_throughput_mbit_s(message_size, latency_p99));
+      printf("%s\n", row);
+      if (datafile_fp != NULL) {
+        fprintf(datafile_fp, "%s\n", row);
+      }
+    }
+  }
+
+  if (world_rank == 0) {
+    INFO_PRINTF("Sweep time: %.3fs", MPI_Wtime() - start_wtime);
+  }
+  if (datafile_fp != NULL) {
+    fclose(datafile_fp);
+  }
+  if (communication == IBSEND) {
+    MPI_Buffer_detach(&buffer_attached, &buffer_attached_size);
+    free(buffer_attached);
+  }
+
+  MPI_Finalize();
+  return 0;
+}